@@ -0,0 +1,26 @@
+#pragma once
+#include <Arduino.h>
+
+// 1 kB in memory, blank (0xFF) at every start: a replay takes its
+// calibration from the trace's STATE records, never from a stored one
+struct EEPROMClass {
+  uint8_t cells[1024];
+
+  EEPROMClass() { memset(cells, 0xFF, sizeof(cells)); }
+
+  uint8_t read(int address) { return cells[address]; }
+  void write(int address, uint8_t value) { cells[address] = value; }
+  void update(int address, uint8_t value) { cells[address] = value; }
+  uint16_t length() { return sizeof(cells); }
+
+  template<typename T> T &get(int address, T &t) {
+    memcpy(&t, cells + address, sizeof(T));
+    return t;
+  }
+  template<typename T> const T &put(int address, const T &t) {
+    memcpy(cells + address, &t, sizeof(T));
+    return t;
+  }
+};
+
+extern EEPROMClass EEPROM;
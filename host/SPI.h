@@ -0,0 +1,19 @@
+#pragma once
+#include <Arduino.h>
+
+// No SPI devices on the host; a flash log store reads back 0xFF (blank)
+#define SPI_MODE0 0x00
+
+struct SPISettings {
+  SPISettings() {}
+  SPISettings(uint32_t, uint8_t, uint8_t) {}
+};
+
+struct SPIClass {
+  void begin() {}
+  void beginTransaction(SPISettings) {}
+  void endTransaction() {}
+  uint8_t transfer(uint8_t) { return 0xFF; }
+};
+
+extern SPIClass SPI;
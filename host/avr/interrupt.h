@@ -0,0 +1,8 @@
+#pragma once
+#include <avr/io.h>
+
+// Vectors are plain functions; core.cpp calls TWI_vect for the bus model
+#define ISR(vector) extern "C" void vector(void)
+
+#define cli() (SREG = SREG & ~_BV(SREG_I))
+#define sei() (SREG = SREG | _BV(SREG_I))
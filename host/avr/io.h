@@ -0,0 +1,56 @@
+#pragma once
+// --- ATmega328P Registers on the Host ---
+// Port, pin-change, timer and watchdog registers are plain bytes nothing
+// else looks at. SREG and TWCR are proxies: restoring the I-bit runs a
+// pending TWI interrupt, and TWCR writes drive a model of the TWI master
+// with modelled slaves (core.cpp, twi_devices.h), so twi.h, the LCD driver
+// and the VL53L1X ranger run unchanged.
+#include <stdint.h>
+
+#define _BV(bit) (1 << (bit))
+
+extern volatile uint8_t PINB, DDRB, PORTB;
+extern volatile uint8_t PINC, DDRC, PORTC;
+extern volatile uint8_t PIND, DDRD, PORTD;
+extern volatile uint8_t PCICR, PCMSK0, PCMSK1, PCMSK2;
+extern volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TIFR1;
+extern volatile uint16_t TCNT1;
+extern volatile uint8_t MCUSR, WDTCSR;
+extern volatile uint8_t TWBR, TWSR, TWAR, TWDR;
+
+struct HostSreg {
+  uint8_t value = 0x80; // interrupts enabled, as after init()
+  operator uint8_t() const { return value; }
+  HostSreg &operator=(uint8_t v);
+};
+extern HostSreg SREG;
+#define SREG_I 7
+
+struct HostTwcr {
+  uint8_t value = 0;
+  operator uint8_t() const { return value; }
+  HostTwcr &operator=(uint8_t v);
+};
+extern HostTwcr TWCR;
+
+#define RAMSTART 0x100
+#define RAMEND 0x8FF
+
+#define PCIE0 0
+#define PCIE1 1
+#define PCIE2 2
+#define CS10 0
+#define TOIE1 0
+#define TOV1 0
+#define WDRF 3
+#define WDE 3
+#define WDCE 4
+#define WDIE 6
+
+#define TWIE 0
+#define TWEN 2
+#define TWWC 3
+#define TWSTO 4
+#define TWSTA 5
+#define TWEA 6
+#define TWINT 7
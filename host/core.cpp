@@ -0,0 +1,245 @@
+#include <Arduino.h>
+#include <util/twi.h>
+#include <EEPROM.h>
+#include <SPI.h>
+#include <stdio.h>
+#include "core.h"
+#include "trace.h"
+#include "twi_devices.h"
+#include "sram.h"
+
+// --- Registers ---
+volatile uint8_t PINB, DDRB, PORTB;
+volatile uint8_t PINC, DDRC, PORTC;
+volatile uint8_t PIND, DDRD, PORTD;
+volatile uint8_t PCICR, PCMSK0, PCMSK1, PCMSK2;
+volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TIFR1;
+volatile uint16_t TCNT1;
+volatile uint8_t MCUSR, WDTCSR;
+volatile uint8_t TWBR, TWSR = TW_NO_INFO, TWAR, TWDR;
+HostSreg SREG;
+HostTwcr TWCR;
+
+EEPROMClass EEPROM;
+SPIClass SPI;
+HardwareSerial Serial;
+
+extern "C" void TWI_vect(void);
+
+// --- Interrupts ---
+// Only the TWI interrupt is modelled. It runs like on the chip: as soon as
+// it is pending with the I-bit set, with the I-bit cleared while it runs.
+static bool twiPending = false;
+
+static void dispatch() {
+  while (twiPending && (SREG.value & _BV(SREG_I)) && (TWCR.value & _BV(TWIE))) {
+    twiPending = false;
+    SREG.value &= ~_BV(SREG_I);
+    TWI_vect();
+    SREG.value |= _BV(SREG_I);
+  }
+}
+
+HostSreg &HostSreg::operator=(uint8_t v) {
+  value = v;
+  dispatch();
+  return *this;
+}
+
+// --- TWI Master ---
+// Each write that clears TWINT completes the bus step at once and sets the
+// next status. The addressed device (twi_devices.h) ACKs or NACKs and
+// supplies the bytes read; an address nobody answers is NACKed.
+static bool busOwned = false;
+static HostTwiDevice *devices = nullptr, *addressed = nullptr;
+
+HostTwiDevice::HostTwiDevice(uint8_t address) : address(address), next(devices) { devices = this; }
+
+static HostTwiDevice *deviceAt(uint8_t address) {
+  for (HostTwiDevice *d = devices; d; d = d->next)
+    if (d->present && d->address == address) return d;
+  return nullptr;
+}
+
+static void release() {
+  if (addressed) addressed->stop();
+  addressed = nullptr;
+  busOwned = false;
+}
+
+HostTwcr &HostTwcr::operator=(uint8_t v) {
+  value = v & ~_BV(TWINT);
+  if (!(v & _BV(TWEN))) {
+    release();
+    return *this;
+  }
+  if (!(v & _BV(TWINT))) return *this;
+  if (v & _BV(TWSTO)) {
+    release();
+    if (!(v & _BV(TWSTA))) {
+      TWSR = TW_NO_INFO;
+      return *this;
+    }
+  }
+
+  uint8_t status;
+  if (v & _BV(TWSTA)) {
+    status = busOwned ? TW_REP_START : TW_START;
+    busOwned = true;
+  } else {
+    switch (TW_STATUS) {
+      case TW_START:
+      case TW_REP_START: {
+        bool read = TWDR & TW_READ;
+        addressed = deviceAt(TWDR >> 1);
+        if (addressed) addressed->start(read);
+        if (read) status = addressed ? TW_MR_SLA_ACK : TW_MR_SLA_NACK;
+        else status = addressed ? TW_MT_SLA_ACK : TW_MT_SLA_NACK;
+        break;
+      }
+      case TW_MT_SLA_ACK:
+      case TW_MT_DATA_ACK:
+        status = addressed->write(TWDR) ? TW_MT_DATA_ACK : TW_MT_DATA_NACK;
+        break;
+      case TW_MR_SLA_ACK:
+      case TW_MR_DATA_ACK:
+        TWDR = addressed->read();
+        status = v & _BV(TWEA) ? TW_MR_DATA_ACK : TW_MR_DATA_NACK;
+        break;
+      default:
+        return *this;
+    }
+  }
+  TWSR = status;
+  value |= _BV(TWINT);
+  twiPending = true;
+  dispatch();
+  return *this;
+}
+
+// --- Time ---
+static unsigned long nowUs = 0;
+
+unsigned long micros() { return nowUs += 4; }
+unsigned long hostMicros() { return nowUs; }
+unsigned long millis() { return micros() / 1000; }
+void delay(unsigned long ms) { nowUs += ms * 1000; }
+void delayMicroseconds(unsigned int us) { nowUs += us; }
+void yield() {}
+
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t, uint8_t) {}
+int digitalRead(uint8_t) { return LOW; }
+
+// --- Stack ---
+// Painted below main()'s frame like paintStack() paints the board's free
+// SRAM, so sram.h measures the firmware's stack the same way
+static const uint16_t STACK_PAINT = 32768;
+static uintptr_t stackTop = 0, stackBottom = 0; // 0 until painted
+
+void hostPaintStack() {
+  volatile uint8_t paint[STACK_PAINT];
+  for (uint16_t i = 0; i < STACK_PAINT; ++i) paint[i] = STACK_CANARY;
+  stackBottom = (uintptr_t)paint;
+  stackTop = stackBottom + STACK_PAINT;
+}
+
+uint16_t hostStackBytesNow() {
+  return stackTop ? stackTop - (uintptr_t)__builtin_frame_address(0) : 0;
+}
+
+uint16_t hostStackSpan() { return stackTop ? STACK_PAINT : 0; }
+
+uint16_t hostStackReserve() {
+  const uint8_t *p = (const uint8_t *)stackBottom;
+  while (p && (uintptr_t)p < stackTop && *p == STACK_CANARY) ++p;
+  return (uintptr_t)p - stackBottom;
+}
+
+// --- Print ---
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t n = 0;
+  while (size--) n += write(*buffer++);
+  return n;
+}
+
+size_t Print::print(const __FlashStringHelper *s) { return write((const char *)s); }
+size_t Print::print(const char *s) { return write(s); }
+size_t Print::print(char c) { return write((uint8_t)c); }
+size_t Print::print(unsigned char n, int base) { return printNumber(n, base); }
+size_t Print::print(unsigned int n, int base) { return printNumber(n, base); }
+size_t Print::print(unsigned long n, int base) { return printNumber(n, base); }
+size_t Print::print(int n, int base) { return print((long)n, base); }
+
+size_t Print::print(long n, int base) {
+  if (n >= 0 || base != DEC) return printNumber(n, base);
+  return print('-') + printNumber(-(unsigned long)n, DEC);
+}
+
+size_t Print::print(double n, int digits) {
+  // Same text as the AVR core for the values the firmware prints
+  if (isnan(n)) return print("nan");
+  if (isinf(n)) return print("inf");
+  if (n > 4294967040.0 || n < -4294967040.0) return print("ovf");
+  char text[48];
+  snprintf(text, sizeof(text), "%.*f", digits, n);
+  return print(text);
+}
+
+size_t Print::println() { return write('\r') + write('\n'); }
+
+size_t Print::printNumber(unsigned long n, int base) {
+  char text[8 * sizeof(long) + 1];
+  char *p = text + sizeof(text) - 1;
+  *p = 0;
+  do {
+    uint8_t digit = n % base;
+    *--p = digit < 10 ? '0' + digit : 'A' + digit - 10;
+    n /= base;
+  } while (n);
+  return write(p);
+}
+
+// --- Serial ---
+// The trace file stands in for the receive buffer. Once it is used up the
+// replay runs on for the tail time so the last session can finish printing.
+static FILE *serialIn = nullptr;
+static unsigned long tailUs = 0, endUs = 0;
+static bool ended = false;
+
+void hostSerialInput(FILE *in, unsigned long tail) {
+  serialIn = in;
+  tailUs = tail;
+}
+
+int HardwareSerial::peek() {
+  int c = serialIn ? getc(serialIn) : EOF;
+  if (c != EOF) {
+    ungetc(c, serialIn);
+    return c;
+  }
+  if (!ended) {
+    ended = true;
+    endUs = nowUs;
+  }
+  if (nowUs - endUs >= tailUs) {
+    fflush(stdout);
+    exit(0);
+  }
+  return -1;
+}
+
+int HardwareSerial::available() { return peek() >= 0 ? 1 : 0; }
+
+int HardwareSerial::read() {
+  int c = peek();
+  return c >= 0 ? getc(serialIn) : -1;
+}
+
+void HardwareSerial::flush() { fflush(stdout); }
+
+size_t HardwareSerial::write(uint8_t b) {
+  if (b == TRACE_ACK) return 1; // The trace reader's flow control, nobody to send it to
+  if (b != '\r') putchar(b);
+  return 1;
+}
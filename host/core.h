@@ -0,0 +1,15 @@
+#pragma once
+#include <stdio.h>
+
+// --- Host Hooks ---
+// For the replay's main(): the trace the firmware reads as its serial input,
+// and how long to keep running once it is used up
+void hostSerialInput(FILE *in, unsigned long tailUs);
+
+// The virtual clock without the 4 us a micros() call costs, for the device
+// models
+unsigned long hostMicros();
+
+// Paints the stack below the caller's frame for sram.h; main() calls it
+// first, so everything the firmware runs is measured
+void hostPaintStack();
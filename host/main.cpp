@@ -0,0 +1,63 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <string.h>
+#include "core.h"
+
+// --- Native Replay ---
+// Runs a captured trace through the firmware on the workstation, the same
+// pipeline the replay environment runs on the board, as fast as the host
+// allows. Text goes to stdout, one "Result:" line per session.
+//
+//   program [--set name=value]... [--tail seconds] [--mem] trace|-
+//
+// --set changes a console setting ("get" lists them) right after boot, as
+// if typed; --tail (default 3) is the virtual time to keep running after
+// the last record so a session in progress can finish; --mem prints what
+// the console's "mem" does once the replay ends, in host sizes.
+
+// pio test -e native links the firmware and this core into each test,
+// which brings its own main()
+#ifndef PIO_UNIT_TESTING
+bool applySetting(const char *name, const char *value); // main.cpp
+void printMemory();
+
+static void usage(const char *program) {
+  fprintf(stderr, "usage: %s [--set name=value]... [--tail seconds] [--mem] trace|-\n", program);
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  hostPaintStack();
+  const char *path = nullptr;
+  double tailSeconds = 3;
+  int sets = 0;
+  char **settings = new char *[argc];
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--set") && i + 1 < argc) settings[sets++] = argv[++i];
+    else if (!strcmp(argv[i], "--tail") && i + 1 < argc) tailSeconds = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--mem")) atexit(printMemory); // Serial exits after the tail
+    else if (argv[i][0] == '-' && argv[i][1]) usage(argv[0]);
+    else if (!path) path = argv[i];
+    else usage(argv[0]);
+  }
+  if (!path) usage(argv[0]);
+
+  FILE *in = strcmp(path, "-") ? fopen(path, "rb") : stdin;
+  if (!in) {
+    perror(path);
+    return 1;
+  }
+  hostSerialInput(in, (unsigned long)(tailSeconds * 1000000));
+
+  setup();
+  for (int i = 0; i < sets; ++i) {
+    char *value = strchr(settings[i], '=');
+    if (value) *value++ = 0;
+    if (!value || !applySetting(settings[i], value)) {
+      fprintf(stderr, "bad setting: %s\n", settings[i]);
+      return 2;
+    }
+  }
+  for (;;) loop(); // Serial ends the process after the trace and the tail
+}
+#endif
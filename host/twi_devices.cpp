@@ -0,0 +1,102 @@
+#include <Arduino.h>
+#include "core.h"
+#include "twi_devices.h"
+
+HostPcf8574 hostLcdExpander(0x27);
+HostVl53l1x hostVl53l1x;
+
+// --- VL53L1X ---
+const uint16_t GPIO_HV_MUX__CTRL = 0x0030;
+const uint16_t GPIO__TIO_HV_STATUS = 0x0031;
+const uint16_t SYSTEM__INTERMEASUREMENT_PERIOD = 0x006C;
+const uint16_t SYSTEM__INTERRUPT_CLEAR = 0x0086;
+const uint16_t SYSTEM__MODE_START = 0x0087;
+const uint16_t RESULT__RANGE_STATUS = 0x0089;
+const uint16_t RESULT__FINAL_RANGE_MM = 0x0096;
+const uint16_t RESULT__OSC_CALIBRATE_VAL = 0x00DE;
+const uint16_t FIRMWARE__SYSTEM_STATUS = 0x00E5;
+const uint16_t IDENTIFICATION__MODEL_ID = 0x010F;
+
+HostVl53l1x::HostVl53l1x() : HostTwiDevice(ADDRESS) { reset(); }
+
+void HostVl53l1x::reset() {
+  memset(registers, 0, sizeof(registers));
+  registers[IDENTIFICATION__MODEL_ID] = 0xEA;
+  registers[IDENTIFICATION__MODEL_ID + 1] = 0xCC;
+  registers[RESULT__OSC_CALIBRATE_VAL] = 0x01; // PLL period 0x148
+  registers[RESULT__OSC_CALIBRATE_VAL + 1] = 0x48;
+  registers[GPIO_HV_MUX__CTRL] = 0x11; // Active low until configured
+  present = true;
+  ranging = ready = false;
+  indexBytes = 0;
+  measurements = 0;
+  poweredUs = hostMicros();
+}
+
+void HostVl53l1x::start(bool read) {
+  if (!read) indexBytes = 0; // A write starts with the register index
+}
+
+bool HostVl53l1x::write(uint8_t b) {
+  if (indexBytes < 2) {
+    index = indexBytes++ ? (index << 8) | b : b;
+    return true;
+  }
+  store(index++, b);
+  return true;
+}
+
+uint8_t HostVl53l1x::read() {
+  update();
+  uint16_t r = index++;
+  if (r >= REGISTERS) return 0;
+  switch (r) {
+    case GPIO__TIO_HV_STATUS: {
+      bool activeLow = registers[GPIO_HV_MUX__CTRL] & 0x10;
+      return ready != activeLow ? 1 : 0;
+    }
+    case FIRMWARE__SYSTEM_STATUS:
+      return hostMicros() - poweredUs >= BOOT_US ? 1 : 0;
+    default:
+      return registers[r];
+  }
+}
+
+void HostVl53l1x::store(uint16_t r, uint8_t v) {
+  if (r >= REGISTERS) return;
+  registers[r] = v;
+  update();
+  if (r == SYSTEM__INTERRUPT_CLEAR && (v & 1)) {
+    ready = false;
+  } else if (r == SYSTEM__MODE_START) {
+    ranging = v == 0x40;
+    ready = false;
+    dueUs = hostMicros() + periodUs();
+  }
+}
+
+// Completes the measurement that is due. The result registers hold the
+// latest one; a measurement while the interrupt is still raised is lost.
+void HostVl53l1x::update() {
+  unsigned long now = hostMicros();
+  if (!ranging || (long)(now - dueUs) < 0) return;
+  if (!ready) {
+    registers[RESULT__RANGE_STATUS] = rangeStatus;
+    registers[RESULT__FINAL_RANGE_MM] = distanceMm >> 8;
+    registers[RESULT__FINAL_RANGE_MM + 1] = distanceMm & 0xFF;
+    ready = true;
+    measurements++;
+  }
+  unsigned long period = periodUs();
+  while ((long)(now - dueUs) >= 0) dueUs += period;
+}
+
+// SYSTEM__INTERMEASUREMENT_PERIOD counts PLL periods x 1.075, the timing
+// budget (33 ms) applies while it is 0
+unsigned long HostVl53l1x::periodUs() const {
+  const uint8_t *p = registers + SYSTEM__INTERMEASUREMENT_PERIOD;
+  uint32_t counts = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | (p[2] << 8) | p[3];
+  uint16_t clockPll = ((registers[RESULT__OSC_CALIBRATE_VAL] << 8) | registers[RESULT__OSC_CALIBRATE_VAL + 1]) & 0x3FF;
+  if (!counts || !clockPll) return 33000;
+  return counts * 1000.0 / (clockPll * 1.075);
+}
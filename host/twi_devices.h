@@ -0,0 +1,69 @@
+#pragma once
+#include <stdint.h>
+
+// --- TWI Slaves on the Host ---
+// Devices on the modelled bus (core.cpp). Each adds itself to the bus when
+// it is constructed; an address without a present device NACKs, as on a
+// real bus.
+struct HostTwiDevice {
+  uint8_t address;
+  bool present = true; // false: off the bus, its address NACKs
+  HostTwiDevice *next;
+
+  explicit HostTwiDevice(uint8_t address);
+  virtual ~HostTwiDevice() {}
+
+  virtual void start(bool read) {}   // addressed after a START or repeated START
+  virtual bool write(uint8_t b) = 0; // false NACKs the byte
+  virtual uint8_t read() = 0;
+  virtual void stop() {}
+};
+
+// PCF8574 I/O expander behind the LCD: every byte sets the port
+struct HostPcf8574 : HostTwiDevice {
+  uint8_t port = 0xFF;
+  unsigned long writes = 0;
+
+  explicit HostPcf8574(uint8_t address) : HostTwiDevice(address) {}
+  bool write(uint8_t b) override { port = b; writes++; return true; }
+  uint8_t read() override { return port; }
+};
+
+// VL53L1X time-of-flight sensor: the registers Vl53l1xRanger uses, with
+// 16-bit register indexes that auto-increment. It boots BOOT_US after
+// power-up and, once SYSTEM__MODE_START is 0x40, completes a measurement of
+// distanceMm every inter-measurement period, raising GPIO__TIO_HV_STATUS
+// (with the polarity GPIO_HV_MUX__CTRL sets) until SYSTEM__INTERRUPT_CLEAR.
+struct HostVl53l1x : HostTwiDevice {
+  static const uint8_t ADDRESS = 0x29;
+  static const uint16_t REGISTERS = 0x0120;
+  static const unsigned long BOOT_US = 1200;
+
+  uint16_t distanceMm = 1000;
+  uint8_t rangeStatus = 9; // 9 = range valid
+  unsigned long measurements = 0;
+
+  HostVl53l1x();
+  void reset(); // Power-up state
+
+  void start(bool read) override;
+  bool write(uint8_t b) override;
+  uint8_t read() override;
+
+  uint8_t reg(uint16_t r) const { return registers[r]; }
+  void setReg(uint16_t r, uint8_t v) { registers[r] = v; }
+
+private:
+  uint8_t registers[REGISTERS];
+  uint16_t index = 0;
+  uint8_t indexBytes = 0; // of the write in progress
+  bool ranging = false, ready = false;
+  unsigned long poweredUs = 0, dueUs = 0;
+
+  void store(uint16_t r, uint8_t v);
+  void update();
+  unsigned long periodUs() const;
+};
+
+extern HostPcf8574 hostLcdExpander; // 0x27, the LCD backpack
+extern HostVl53l1x hostVl53l1x;
@@ -0,0 +1,121 @@
+#pragma once
+#include <Arduino.h>
+#include "eeprom_layout.h"
+#include "persistent.h"
+
+// --- Running Mean / Variance (Welford) ---
+struct RunningStats {
+  unsigned int n = 0;
+  float mean = 0, m2 = 0;
+
+  void reset() { n = 0; mean = m2 = 0; }
+
+  void add(float x) {
+    n++;
+    float d = x - mean;
+    mean += d / n;
+    m2 += d * (x - mean);
+  }
+
+  float variance() const { return n > 1 ? m2 / (n - 1) : 0; }
+  float stddev() const { return sqrt(variance()); }
+  // Standard error of the mean
+  float error() const { return n ? sqrt(variance() / n) : 0; }
+};
+
+// --- Persisted Calibration ---
+// The zero is stored on its own (StoredZero), since re-zeroing moves it far
+// more often than the factor changes. Records from before the split (magic
+// 0xCA1B, with the offset) are not read: such units need a new "cal".
+struct CalibrationData {
+  float factor; // raw counts per kg at SCALE_GAIN
+};
+
+template<>
+struct PersistentCheck<CalibrationData> {
+  static bool valid(const CalibrationData &d) { return d.factor != 0 && !isnan(d.factor); }
+};
+typedef Persistent<CalibrationData, EEPROM_CALIBRATION, 0xCA1C> StoredCalibration;
+
+// --- Guided Calibration ---
+// Zero, reference mass and an optional check mass are each captured once the
+// raw average has settled and its standard error is below the target precision.
+// Steps advance automatically; next() forces the current capture.
+struct Calibrator {
+  enum State : uint8_t { IDLE, ZERO, REFERENCE, CHECK, DONE, FAILED };
+
+  static const unsigned int MIN_SAMPLES = 16;
+  static const unsigned int MAX_SAMPLES = 400;
+  static constexpr float LINEARITY_TOLERANCE = 0.005; // 0.5 % of the check mass
+
+  State state = IDLE;
+  float referenceKg = 0, checkKg = 0;
+  float targetKg = 0.01;  // standard error wanted for each point
+  float countsPerKgGuess; // previous factor, only used to size the sample count
+  RunningStats stats;
+  float zero = 0, noise = 0;
+  float factor = 0, linearityError = 0;
+
+  bool active() const { return state == ZERO || state == REFERENCE || state == CHECK; }
+
+  void start(float referenceKg, float checkKg, float currentFactor) {
+    this->referenceKg = referenceKg;
+    this->checkKg = checkKg;
+    countsPerKgGuess = fabs(currentFactor);
+    stats.reset();
+    state = ZERO;
+  }
+
+  void cancel() { state = IDLE; }
+
+  void next() {
+    if (active() && stats.n >= 2) capture();
+  }
+
+  // Feeds one raw HX711 count, returns true when the step changed
+  bool feed(long raw) {
+    if (!active()) return false;
+
+    // Off-zero steps wait for the load, then restart averaging on any jump
+    if (state != ZERO && stats.n >= 2 && fabs(raw - stats.mean) > 8 * noise + 0.002 * countsPerKgGuess) stats.reset();
+    stats.add(raw);
+
+    if (state != ZERO && fabs(stats.mean - zero) < 50 * noise + 0.05 * countsPerKgGuess) {
+      if (stats.n > 2) stats.reset(); // nothing placed yet
+      return false;
+    }
+    if (stats.n < MIN_SAMPLES) return false;
+    if (stats.n < MAX_SAMPLES && stats.error() > targetKg * countsPerKgGuess) return false;
+    capture();
+    return true;
+  }
+
+  // Samples needed for the target precision at the measured noise
+  unsigned int samplesNeeded() const {
+    float n = sq(noise / (targetKg * countsPerKgGuess));
+    return n < MIN_SAMPLES ? MIN_SAMPLES : n > MAX_SAMPLES ? MAX_SAMPLES : (unsigned int)n;
+  }
+
+private:
+  void capture() {
+    switch (state) {
+      case ZERO:
+        zero = stats.mean;
+        noise = stats.stddev();
+        state = REFERENCE;
+        break;
+      case REFERENCE:
+        factor = (stats.mean - zero) / referenceKg;
+        countsPerKgGuess = fabs(factor);
+        state = checkKg > 0 ? CHECK : DONE;
+        break;
+      case CHECK:
+        linearityError = (stats.mean - zero) / factor - checkKg;
+        state = fabs(linearityError) <= LINEARITY_TOLERANCE * checkKg ? DONE : FAILED;
+        break;
+      default:
+        break;
+    }
+    stats.reset();
+  }
+};
@@ -0,0 +1,93 @@
+#pragma once
+#include <Arduino.h>
+
+// --- Serial Console ---
+// Collects characters without blocking and hands out complete lines, which are
+// then split into whitespace-separated tokens in place (no allocation).
+template<uint8_t SIZE = 40>
+struct Console {
+  char line[SIZE];
+  uint8_t length = 0;
+  bool overflow = false;
+  char *cursor = line;
+
+  // Returns true once a full line has been received; call next() for its tokens
+  bool poll(Stream &in) {
+    while (in.available()) {
+      char c = in.read();
+      if (c == '\r' || c == '\n') {
+        if (length == 0 && !overflow) continue; // empty line or second half of CRLF
+        bool ok = !overflow;
+        line[length] = 0;
+        length = 0;
+        overflow = false;
+        cursor = line;
+        if (ok) return true;
+        continue;
+      }
+      if (length < SIZE - 1) line[length++] = c;
+      else overflow = true; // too long, drop the whole line
+    }
+    return false;
+  }
+
+  // Next token of the current line, or nullptr when there are no more
+  char *next() {
+    while (*cursor == ' ' || *cursor == '\t') cursor++;
+    if (!*cursor) return nullptr;
+    char *token = cursor;
+    while (*cursor && *cursor != ' ' && *cursor != '\t') cursor++;
+    if (*cursor) *cursor++ = 0;
+    return token;
+  }
+};
+
+// --- Live Parameters ---
+// Values outside min..max are rejected by parse() and clamped by clamp()
+struct ConsoleParam {
+  enum Type : uint8_t { FLOAT, INT, ULONG };
+  const char *name;
+  Type type;
+  void *value;
+  float min, max;
+
+  void print(Print &out) const {
+    out.print(name);
+    out.print(F(" = "));
+    switch (type) {
+      case FLOAT: out.println(*(float *)value); break;
+      case INT: out.println(*(int *)value); break;
+      case ULONG: out.println(*(unsigned long *)value); break;
+    }
+  }
+
+  void printRange(Print &out) const {
+    out.print(F("error: "));
+    out.print(name);
+    out.print(' ');
+    out.print(min, type == FLOAT ? 2 : 0);
+    out.print(F(".."));
+    out.println(max, type == FLOAT ? 2 : 0);
+  }
+
+  bool parse(const char *text) {
+    char *end;
+    switch (type) {
+      case FLOAT: { float v = strtod(text, &end); if (end == text || *end || !inRange(v)) return false; *(float *)value = v; break; }
+      case INT: { long v = strtol(text, &end, 10); if (end == text || *end || !inRange(v)) return false; *(int *)value = v; break; }
+      case ULONG: { unsigned long v = strtoul(text, &end, 10); if (end == text || *end || !inRange(v)) return false; *(unsigned long *)value = v; break; }
+    }
+    return true;
+  }
+
+  void clamp() {
+    switch (type) {
+      case FLOAT: { float &v = *(float *)value; if (!inRange(v)) v = v > max ? max : min; break; } // NaN goes to min
+      case INT: { int &v = *(int *)value; v = constrain(v, (int)min, (int)max); break; }
+      case ULONG: { unsigned long &v = *(unsigned long *)value; v = constrain(v, (unsigned long)min, (unsigned long)max); break; }
+    }
+  }
+
+private:
+  bool inRange(float v) const { return v >= min && v <= max; } // false for NaN
+};
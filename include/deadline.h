@@ -0,0 +1,180 @@
+#pragma once
+#include <Arduino.h>
+#include <avr/wdt.h>
+#include "eeprom_layout.h"
+#include "persistent.h"
+
+// --- Loop Deadlines ---
+// Soft deadlines: each task has a time budget, and finish() counts the runs
+// that overrun it and keeps the worst. Hard deadline: the hardware watchdog
+// in interrupt + reset mode. When nothing kicks it for WATCHDOG_TIMEOUT,
+// ISR(WDT_vect) notes the task that was running and how long it had run in
+// a WatchdogSnapshot in .noinit RAM, which a reset leaves alone; no EEPROM
+// writes in the ISR. The next timeout resets the board, and begin() moves
+// the snapshot into the crash record. A kick() between the two timeouts
+// means the loop recovered: the snapshot is dropped and counted as a stall.
+//
+// The hardware clears WDIE when the interrupt runs, so kick() re-arms it.
+// A watchdog reset needs a bootloader that stops the watchdog (Optiboot,
+// env:nanoatmega328new); the old Nano bootloader waits for an upload with
+// the watchdog still at its 16 ms reset timeout, and boot-loops. Builds for
+// it (env:nanoatmega328) define NO_WATCHDOG: the soft deadlines and the
+// worst-miss record stay, the watchdog is never started.
+
+// Survives resets for field diagnosis
+struct CrashRecord {
+  uint8_t task;       // running when the watchdog fired, NO_TASK if never
+  uint16_t elapsedMs; // how long it had been running
+  uint8_t resets;     // watchdog resets so far
+  uint8_t worstTask;  // slowest deadline miss on record
+  uint16_t worstMs;
+};
+typedef Persistent<CrashRecord, EEPROM_CRASH_RECORD, 0xDEAD> StoredCrash;
+
+// Written only by ISR(WDT_vect); the key tells it from power-up garbage
+struct WatchdogSnapshot {
+  static const uint32_t KEY = 0x57A11ED5;
+
+  uint32_t key;
+  uint8_t task;
+  uint16_t elapsedMs;
+};
+
+struct DeadlineMonitor {
+  enum Task : uint8_t { LOOP, ACQUIRE, DISPLAY, CONSOLE, LOG, TASKS, NO_TASK = 0xFF };
+  static const uint8_t WATCHDOG_TIMEOUT = WDTO_2S;
+
+  struct Stats {
+    uint16_t budgetMs;
+    uint16_t worstMs;
+    unsigned long runs, misses;
+    unsigned long started;
+    uint8_t parent; // task interrupted by this one
+  };
+
+  Stats stats[TASKS];
+  volatile uint8_t active = NO_TASK;
+  StoredCrash crash;
+  volatile WatchdogSnapshot *snapshot = nullptr; // in .noinit
+  bool watchdogReset = false; // this boot follows a watchdog reset
+  unsigned long stalls = 0;   // watchdog interrupts the loop recovered from
+
+  // budgets holds TASKS entries in Task order; noinit must live in .noinit
+  void begin(const uint16_t *budgets, volatile WatchdogSnapshot &noinit) {
+    for (uint8_t t = 0; t < TASKS; ++t) {
+      stats[t] = Stats();
+      stats[t].budgetMs = budgets[t];
+    }
+    if (!crash.load()) clearRecord();
+    snapshot = &noinit;
+    watchdogReset = snapshot->key == WatchdogSnapshot::KEY;
+    if (watchdogReset) {
+      crash.value.task = snapshot->task;
+      crash.value.elapsedMs = snapshot->elapsedMs;
+      if (crash.value.resets < 255) crash.value.resets++;
+      crash.save();
+    }
+    snapshot->key = 0;
+#ifndef NO_WATCHDOG
+    wdt_enable(WATCHDOG_TIMEOUT);
+    WDTCSR |= _BV(WDIE); // Interrupt first, reset on the following timeout
+#endif
+  }
+
+  void kick() {
+#ifndef NO_WATCHDOG
+    wdt_reset();
+    if (!snapshot || (WDTCSR & _BV(WDIE))) return;
+    // The interrupt ran and the loop came back before the reset
+    snapshot->key = 0;
+    stalls++;
+    WDTCSR |= _BV(WDIE);
+#endif
+  }
+
+  void start(Task t) {
+    stats[t].started = millis();
+    stats[t].parent = active;
+    active = t;
+  }
+
+  // Returns true when the task overran its budget
+  bool finish(Task t) {
+    Stats &s = stats[t];
+    unsigned long elapsed = millis() - s.started;
+    uint16_t ms = elapsed > 0xFFFF ? 0xFFFF : elapsed;
+    active = s.parent;
+    s.runs++;
+    if (ms > s.worstMs) s.worstMs = ms;
+    if (ms <= s.budgetMs) return false;
+    s.misses++;
+    // New worst on record; a 25 % margin limits EEPROM writes
+    if (ms > crash.value.worstMs + crash.value.worstMs / 4) {
+      crash.value.worstTask = t;
+      crash.value.worstMs = ms;
+      crash.save();
+    }
+    return true;
+  }
+
+  // From ISR(WDT_vect): the board resets at the next timeout unless kicked
+  void onWatchdog() {
+    if (!snapshot) return;
+    uint8_t t = active;
+    snapshot->task = t;
+    snapshot->elapsedMs = t < TASKS ? min(millis() - stats[t].started, 0xFFFFUL) : 0;
+    snapshot->key = WatchdogSnapshot::KEY;
+  }
+
+  void clearRecord() {
+    crash.value.task = crash.value.worstTask = NO_TASK;
+    crash.value.elapsedMs = crash.value.worstMs = 0;
+    crash.value.resets = 0;
+    crash.save();
+  }
+
+  void reset() {
+    for (uint8_t t = 0; t < TASKS; ++t) stats[t].runs = stats[t].misses = stats[t].worstMs = 0;
+    stalls = 0;
+  }
+
+  void print(Print &out) const {
+    for (uint8_t t = 0; t < TASKS; ++t) {
+      const Stats &s = stats[t];
+      out.print(name(t));
+      out.print(F(": n="));
+      out.print(s.runs);
+      out.print(F(" miss="));
+      out.print(s.misses);
+      out.print(F(" max="));
+      out.print(s.worstMs);
+      out.print(F("ms budget="));
+      out.print(s.budgetMs);
+      out.println(F("ms"));
+    }
+    out.print(F("watchdog stalls: "));
+    out.print(stalls);
+    out.print(F(", resets: "));
+    out.print(crash.value.resets);
+    out.print(F(", last in "));
+    out.print(name(crash.value.task));
+    out.print(F(" after "));
+    out.print(crash.value.elapsedMs);
+    out.print(F("ms; worst miss "));
+    out.print(name(crash.value.worstTask));
+    out.print(F(" "));
+    out.print(crash.value.worstMs);
+    out.println(F("ms"));
+  }
+
+  static const __FlashStringHelper *name(uint8_t t) {
+    switch (t) {
+      case LOOP: return F("loop");
+      case ACQUIRE: return F("acquire");
+      case DISPLAY: return F("display");
+      case CONSOLE: return F("console");
+      case LOG: return F("log");
+      default: return F("-");
+    }
+  }
+};
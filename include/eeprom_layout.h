@@ -0,0 +1,16 @@
+#pragma once
+
+// --- EEPROM Address Map (ATmega328P: 1024 bytes) ---
+// 0..99 hold persistent settings, the rest is the circular session log.
+// The log start stays a whole number of 6-byte records after the old 64.
+const int EEPROM_SETTINGS_START = 0;
+const int EEPROM_LOG_START = 100;
+const int EEPROM_LOG_END = 1024;
+
+// --- Settings Region ---
+// Record sizes are on the AVR; main.cpp checks that each fits its slot
+const int EEPROM_CALIBRATION = EEPROM_SETTINGS_START; // StoredCalibration, 7 bytes
+const int EEPROM_MOUNT_HEIGHT = EEPROM_SETTINGS_START + 16; // StoredMountHeight, 7 bytes
+const int EEPROM_CHANNEL_TRIMS = EEPROM_SETTINGS_START + 24; // StoredTrims, 7 bytes, 19 with four cells
+const int EEPROM_SCALE_ZERO = EEPROM_SETTINGS_START + 64; // StoredZero, 11 bytes, 23 with four cells
+const int EEPROM_CRASH_RECORD = EEPROM_SETTINGS_START + 88; // StoredCrash, 10 bytes
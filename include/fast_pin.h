@@ -0,0 +1,29 @@
+#pragma once
+#include <Arduino.h>
+
+// --- Compile-Time GPIO ---
+// Arduino Nano pin numbers resolved to fixed I/O registers, so every call
+// inlines to a single sbi/cbi/sbic instruction instead of digitalWrite()'s
+// table lookups. Digital pins 0-7 are PORTD, 8-13 PORTB, A0-A5 (14-19) PORTC.
+template<uint8_t PIN>
+struct FastPin {
+  static_assert(PIN < 20, "not a Nano GPIO pin");
+  enum : uint8_t { MASK = 1 << (PIN < 8 ? PIN : PIN < 14 ? PIN - 8 : PIN - 14) };
+
+  static inline volatile uint8_t &port() __attribute__((always_inline)) { return PIN < 8 ? PORTD : PIN < 14 ? PORTB : PORTC; }
+  static inline volatile uint8_t &ddr() __attribute__((always_inline)) { return PIN < 8 ? DDRD : PIN < 14 ? DDRB : DDRC; }
+  static inline volatile uint8_t &in() __attribute__((always_inline)) { return PIN < 8 ? PIND : PIN < 14 ? PINB : PINC; }
+
+  // Pin-change interrupt group: PCINT0_vect for PORTB, PCINT1_vect PORTC, PCINT2_vect PORTD
+  static inline volatile uint8_t &pcmsk() __attribute__((always_inline)) { return PIN < 8 ? PCMSK2 : PIN < 14 ? PCMSK0 : PCMSK1; }
+  static inline void enableChangeInterrupt() __attribute__((always_inline)) {
+    pcmsk() |= MASK;
+    PCICR |= _BV(PIN < 8 ? PCIE2 : PIN < 14 ? PCIE0 : PCIE1);
+  }
+
+  static inline void output() __attribute__((always_inline)) { ddr() |= MASK; }
+  static inline void input() __attribute__((always_inline)) { ddr() &= ~MASK; port() &= ~MASK; }
+  static inline void high() __attribute__((always_inline)) { port() |= MASK; }
+  static inline void low() __attribute__((always_inline)) { port() &= ~MASK; }
+  static inline bool read() __attribute__((always_inline)) { return in() & MASK; }
+};
@@ -0,0 +1,91 @@
+#pragma once
+#include <Arduino.h>
+
+// --- HX711 Glitch Rejection ---
+// Screens each multi-channel conversion before it is averaged. Dropped:
+//  - saturation codes (0x7FFFFF / -0x800000), which an overloaded or
+//    disconnected input reads as;
+//  - bit slips, a jump to twice, half or minus the last count, from a clock
+//    edge missed or doubled during the shift-out;
+//  - any other jump beyond maxSlew counts from the last good conversion.
+// Bit slips are tested first and matched to within noise counts, a tolerance
+// near the conversion noise: a slip at a small count (a sign flip near zero,
+// halving at a low load) is well inside maxSlew, and only a jump that stays
+// within the noise is too small to tell from one.
+// A jump that the next conversion confirms is a real load change and is
+// accepted, so stepping on costs one conversion instead of stalling.
+template<uint8_t CHANNELS>
+struct GlitchFilter {
+  static const long SATURATED_HIGH = 0x7FFFFFL;
+  static const long SATURATED_LOW = -0x800000L;
+
+  long last[CHANNELS];    // last accepted conversion
+  long pending[CHANNELS]; // rejected jump waiting for confirmation
+  bool primed = false, hasPending = false;
+  unsigned long saturated = 0, slipped = 0, slewed = 0;
+
+  // True when the conversion may be used. A rejected conversion is replaced
+  // in raw by the last good one, so later users of the counts see no glitch.
+  bool accept(long *raw, long maxSlew, long noise) {
+    for (uint8_t c = 0; c < CHANNELS; ++c) {
+      if (raw[c] == SATURATED_HIGH || raw[c] == SATURATED_LOW) {
+        saturated++;
+        return reject(raw, false);
+      }
+    }
+    if (!primed || (hasPending && within(raw, pending, maxSlew))) return take(raw);
+
+    if (slip(raw, noise)) {
+      slipped++;
+    } else if (within(raw, last, maxSlew)) {
+      return take(raw);
+    } else {
+      slewed++;
+    }
+    memcpy(pending, raw, sizeof(pending));
+    return reject(raw, true);
+  }
+
+  unsigned long rejected() const { return saturated + slipped + slewed; }
+
+  // After a gain change the counts scale and would all look like jumps
+  void reset() { primed = hasPending = false; }
+
+  void print(Print &out) const {
+    out.print(F("rejected: saturated "));
+    out.print(saturated);
+    out.print(F(", bit slip "));
+    out.print(slipped);
+    out.print(F(", slew "));
+    out.println(slewed);
+  }
+
+private:
+  // Some channel moved beyond the noise to where a slip of last would land
+  bool slip(const long *raw, long noise) const {
+    for (uint8_t c = 0; c < CHANNELS; ++c) {
+      long v = raw[c], l = last[c];
+      if (labs(v - l) <= noise) continue;
+      if (labs(v - 2 * l) <= noise || labs(v - l / 2) <= noise || labs(v + l) <= noise) return true;
+    }
+    return false;
+  }
+
+  bool take(const long *raw) {
+    memcpy(last, raw, sizeof(last));
+    primed = true;
+    hasPending = false;
+    return true;
+  }
+
+  static bool within(const long *a, const long *b, long limit) {
+    for (uint8_t c = 0; c < CHANNELS; ++c) if (labs(a[c] - b[c]) > limit) return false;
+    return true;
+  }
+
+  bool reject(long *raw, bool keepPending) {
+    hasPending = keepPending;
+    if (primed) memcpy(raw, last, sizeof(last));
+    return false;
+  }
+};
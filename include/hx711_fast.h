@@ -0,0 +1,150 @@
+#pragma once
+#include <Arduino.h>
+#include "fast_pin.h"
+
+// --- HX711 Driver ---
+// Same interface as the bogde/HX711 calls used here, but bit-banged through
+// FastPin with interrupts off for a fixed, short time per conversion.
+//
+// Any number of HX711s can share PD_SCK, each with its own DOUT on the same
+// port: every clock pulse takes one snapshot of the PIN register, so all
+// channels are read in the time of one (24 snapshots, ~10 us). The bits are
+// sorted into per-channel counts afterwards, outside the critical section.
+// read() and the units functions work on the trimmed sum of all channels.
+
+constexpr uint8_t pinPort(uint8_t pin) { return pin < 8 ? 0 : pin < 14 ? 1 : 2; }
+constexpr uint8_t pinMask(uint8_t pin) { return 1 << (pin < 8 ? pin : pin < 14 ? pin - 8 : pin - 14); }
+constexpr uint8_t pinMasks() { return 0; }
+template<typename... T> constexpr uint8_t pinMasks(uint8_t pin, T... rest) { return pinMask(pin) | pinMasks(rest...); }
+constexpr bool samePort(uint8_t) { return true; }
+template<typename... T> constexpr bool samePort(uint8_t a, uint8_t b, T... rest) { return pinPort(a) == pinPort(b) && samePort(b, rest...); }
+
+// Zero, factor and trims of a set of channels, shared by the hardware driver
+// and the trace replay backend. Derived supplies read(), which fills raw[]
+// and returns trimmedSum(); everything here reads through it.
+template<typename Derived, uint8_t N>
+struct HX711Units {
+  static const uint8_t CHANNELS = N;
+
+  long offset = 0;        // of the trimmed sum
+  float factor = 1;
+  long raw[CHANNELS];     // latest conversion of each channel
+  long channelOffset[CHANNELS];
+  float trim[CHANNELS];   // relative gain of each cell, balances the corners
+
+  HX711Units() {
+    for (uint8_t c = 0; c < CHANNELS; ++c) { raw[c] = channelOffset[c] = 0; trim[c] = 1; }
+  }
+
+  // Sum of the latest conversions, each scaled by its cell's trim
+  long trimmedSum() const {
+    long sum = 0;
+    for (uint8_t c = 0; c < CHANNELS; ++c) sum += CHANNELS == 1 ? raw[c] : (long)(trim[c] * raw[c]);
+    return sum;
+  }
+
+  long read_average(uint8_t times = 10) {
+    long sum = 0;
+    for (uint8_t i = 0; i < times; ++i) sum += self().read();
+    return sum / times;
+  }
+
+  double get_value(uint8_t times = 1) { return read_average(times) - offset; }
+  float get_units(uint8_t times = 1) { return get_value(times) / factor; }
+
+  void tare(uint8_t times = 10) {
+    long sum = 0, channelSum[CHANNELS] = {};
+    for (uint8_t i = 0; i < times; ++i) {
+      sum += self().read();
+      for (uint8_t c = 0; c < CHANNELS; ++c) channelSum[c] += raw[c];
+    }
+    offset = sum / times;
+    for (uint8_t c = 0; c < CHANNELS; ++c) channelOffset[c] = channelSum[c] / times;
+  }
+
+  // Load on one cell from its latest conversion
+  float channelUnits(uint8_t c) { return trim[c] * (raw[c] - channelOffset[c]) / factor; }
+
+  void set_scale(float scale = 1.f) { factor = scale; }
+  float get_scale() { return factor; }
+  void set_offset(long value = 0) {
+    // Keep the per-channel zeros consistent with a new total zero
+    long shift = (value - offset) / CHANNELS;
+    for (uint8_t c = 0; c < CHANNELS; ++c) channelOffset[c] += shift;
+    offset = value;
+  }
+  long get_offset() { return offset; }
+
+private:
+  Derived &self() { return *static_cast<Derived *>(this); }
+};
+
+template<uint8_t SCK, uint8_t DOUT, uint8_t... MORE_DOUT>
+struct MultiHX711 : HX711Units<MultiHX711<SCK, DOUT, MORE_DOUT...>, 1 + sizeof...(MORE_DOUT)> {
+  static const uint8_t CHANNELS = 1 + sizeof...(MORE_DOUT);
+  static_assert(samePort(DOUT, MORE_DOUT...), "all DOUT pins must share one port");
+  static constexpr uint8_t MASKS[CHANNELS] = { pinMask(DOUT), pinMask(MORE_DOUT)... };
+  enum : uint8_t { ALL = pinMasks(DOUT, MORE_DOUT...) };
+
+  typedef FastPin<DOUT> Dout; // reads the whole port
+  typedef FastPin<SCK> Sck;
+
+  uint8_t gainPulses = 1; // extra clocks after the data select the next gain/channel
+
+  void begin(uint8_t gain = 128) {
+    for (uint8_t c = 0; c < CHANNELS; ++c) {
+      Dout::ddr() &= ~MASKS[c];
+      Dout::port() &= ~MASKS[c];
+    }
+    Sck::output();
+    Sck::low();
+    // Power-up selects gain 128, so only other gains wait for a conversion
+    if (gain != 128) set_gain(gain);
+  }
+
+  // True once every channel has a conversion waiting
+  bool is_ready() { return !(Dout::in() & ALL); }
+
+  void wait_ready() { while (!is_ready()) yield(); }
+
+  void set_gain(uint8_t gain = 128) {
+    gainPulses = gain == 64 ? 3 : gain == 32 ? 2 : 1;
+    read(); // The new gain applies from the next conversion
+  }
+
+  // Reads all channels into raw[], returns their trimmed sum
+  long read() {
+    wait_ready();
+    uint8_t snapshot[24];
+    uint8_t sreg = SREG;
+    cli(); // PD_SCK high for more than 60 us powers the HX711s down
+    for (uint8_t i = 0; i < 24; ++i) {
+      Sck::high();
+      __asm__ __volatile__("nop\n\tnop"); // DOUT settles 0.1 us after the rising edge
+      snapshot[i] = Dout::in();
+      Sck::low();
+    }
+    for (uint8_t i = 0; i < gainPulses; ++i) {
+      Sck::high();
+      __asm__ __volatile__("nop\n\tnop\n\tnop");
+      Sck::low();
+    }
+    SREG = sreg;
+
+    for (uint8_t c = 0; c < CHANNELS; ++c) {
+      uint8_t mask = MASKS[c];
+      // 24-bit two's complement, sign bit first
+      uint32_t value = snapshot[0] & mask ? 0xFFFFFFFFUL : 0;
+      for (uint8_t i = 0; i < 24; ++i) value = (value << 1) | ((snapshot[i] & mask) ? 1 : 0);
+      this->raw[c] = (int32_t)value;
+    }
+    return this->trimmedSum();
+  }
+};
+
+template<uint8_t SCK, uint8_t DOUT, uint8_t... MORE_DOUT>
+constexpr uint8_t MultiHX711<SCK, DOUT, MORE_DOUT...>::MASKS[];
+
+// Single load cell
+template<uint8_t DOUT, uint8_t SCK>
+using HX711Fast = MultiHX711<SCK, DOUT>;
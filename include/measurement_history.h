@@ -0,0 +1,100 @@
+#pragma once
+#include <Arduino.h>
+
+// One loop sample packed into 6 bytes
+struct Sample {
+  uint16_t time;   // millis() truncated to 16 bits, ages up to ~65 s compare correctly
+  int16_t weight;  // dag (10 g), negative = no reading
+  int16_t height;  // mm, negative = no reading
+};
+
+// Statically allocated ring buffer of the most recent samples.
+// N must be a power of two so wrapping is a mask instead of a division.
+template<uint8_t N>
+struct MeasurementHistory {
+  static_assert(N && (N & (N - 1)) == 0, "history size must be a power of two");
+
+  enum Field : uint8_t { WEIGHT, HEIGHT };
+
+  Sample samples[N];
+  uint8_t head = 0;  // index of the next write
+  uint8_t count = 0;
+
+  void push(unsigned long timeMs, float weightKg, float heightCm) {
+    Sample &s = samples[head];
+    s.time = (uint16_t)timeMs;
+    s.weight = toFixed(weightKg, 100);
+    s.height = toFixed(heightCm, 10);
+    head = (head + 1) & (N - 1);
+    if (count < N) count++;
+  }
+
+  uint8_t size() const { return count; }
+  static uint8_t capacity() { return N; }
+
+  // age 0 = newest sample
+  const Sample &at(uint8_t age) const { return samples[(head - 1 - age) & (N - 1)]; }
+
+  static float weightKg(const Sample &s) { return s.weight / 100.0; }
+  static float heightCm(const Sample &s) { return s.height / 10.0; }
+
+  // Number of samples newer than windowMs, clamped to the history size
+  uint8_t samplesWithin(uint16_t nowMs, uint16_t windowMs) const {
+    uint8_t n = 0;
+    while (n < count && (uint16_t)(nowMs - at(n).time) <= windowMs) n++;
+    return n;
+  }
+
+  // Window queries over the newest n samples (n is clamped to size())
+  int16_t minimum(Field f, uint8_t n) const {
+    n = clampWindow(n);
+    int16_t m = INT16_MAX;
+    for (uint8_t i = 0; i < n; ++i) { int16_t v = value(at(i), f); if (v < m) m = v; }
+    return m;
+  }
+
+  int16_t maximum(Field f, uint8_t n) const {
+    n = clampWindow(n);
+    int16_t m = INT16_MIN;
+    for (uint8_t i = 0; i < n; ++i) { int16_t v = value(at(i), f); if (v > m) m = v; }
+    return m;
+  }
+
+  // Lower median: the sample of rank (n - 1) / 2 once sorted, so always one
+  // of the samples. Quickselect on a stack copy: each partition keeps only
+  // the side holding the rank, O(n) on average.
+  int16_t median(Field f, uint8_t n) const {
+    n = clampWindow(n);
+    if (n == 0) return 0;
+    int16_t v[N];
+    for (uint8_t i = 0; i < n; ++i) v[i] = value(at(i), f);
+    int16_t k = (n - 1) / 2;
+    int16_t lo = 0, hi = n - 1;
+    while (lo < hi) {
+      int16_t pivot = v[(lo + hi) / 2];
+      int16_t i = lo, j = hi;
+      while (i <= j) {
+        while (v[i] < pivot) i++;
+        while (v[j] > pivot) j--;
+        if (i > j) break;
+        int16_t t = v[i]; v[i++] = v[j]; v[j--] = t;
+      }
+      // v[lo..j] <= pivot <= v[i..hi], anything between equals the pivot
+      if (k <= j) hi = j;
+      else if (k >= i) lo = i;
+      else break;
+    }
+    return v[k];
+  }
+
+  static int16_t value(const Sample &s, Field f) { return f == WEIGHT ? s.weight : s.height; }
+
+private:
+  uint8_t clampWindow(uint8_t n) const { return n < count ? n : count; }
+
+  static int16_t toFixed(float value, int16_t scale) {
+    if (value < 0) return -1;
+    float fixed = value * scale + 0.5;
+    return fixed > INT16_MAX ? INT16_MAX : (int16_t)fixed;
+  }
+};
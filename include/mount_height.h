@@ -0,0 +1,104 @@
+#pragma once
+#include <Arduino.h>
+#include "eeprom_layout.h"
+#include "persistent.h"
+
+// --- Persisted Mount Height ---
+struct MountHeightData {
+  float cm;
+};
+
+template<>
+struct PersistentCheck<MountHeightData> {
+  static bool valid(const MountHeightData &d) { return d.cm > 0 && !isnan(d.cm); }
+};
+typedef Persistent<MountHeightData, EEPROM_MOUNT_HEIGHT, 0x4D48> StoredMountHeight;
+
+// --- Mount Height Learning ---
+// Empty-platform pings are averaged in groups and the median of the last few
+// group means (median-of-means) is tracked slowly. A group far from the learned
+// floor means something is under the sensor; if it persists for minutes the
+// kiosk has been moved and the new floor is adopted.
+struct MountHeightLearner {
+  static const uint8_t GROUP = 8;             // pings per mean
+  static const uint8_t MEANS = 5;             // means per median
+  static const uint8_t JUMP_GROUPS = 2;       // groups off the floor before flagging
+  static const uint8_t RELOCATE_GROUPS = 120; // groups off the floor before re-learning
+  static constexpr float JUMP_CM = 8.0;
+  static constexpr float TRACK_RATE = 0.1;    // fraction of each median step followed
+  static constexpr float SAVE_STEP_CM = 0.5;  // EEPROM write threshold
+
+  enum Event : uint8_t { NONE, UPDATED, OBSTRUCTED, CLEARED };
+
+  bool learned = false; // a floor distance has been measured (now or before reboot)
+  bool obstructed = false;
+  float savedCm = 0;
+
+  float sum = 0;
+  uint8_t pings = 0;
+  float means[MEANS];
+  uint8_t meanCount = 0, meanHead = 0;
+  uint8_t offGroups = 0;
+
+  void begin(float &mountHeightCm) {
+    StoredMountHeight stored;
+    if (stored.load()) {
+      mountHeightCm = savedCm = stored.value.cm;
+      learned = true;
+    }
+  }
+
+  // Drops a partly collected group, e.g. when someone steps on
+  void interrupt() { sum = 0; pings = 0; }
+
+  Event add(float distanceCm, float &mountHeightCm) {
+    if (distanceCm < 0) return NONE;
+    sum += distanceCm;
+    if (++pings < GROUP) return NONE;
+    float mean = sum / GROUP;
+    interrupt();
+
+    if (learned && fabs(mean - mountHeightCm) > JUMP_CM) {
+      if (++offGroups >= RELOCATE_GROUPS) {
+        learned = false; // Moved to a new site, start over
+        meanCount = 0;
+      } else if (offGroups >= JUMP_GROUPS && !obstructed) {
+        obstructed = true;
+        return OBSTRUCTED;
+      } else {
+        return NONE;
+      }
+    }
+    offGroups = 0;
+    Event event = obstructed ? CLEARED : UPDATED;
+    obstructed = false;
+
+    means[meanHead] = mean;
+    meanHead = (meanHead + 1) % MEANS;
+    if (meanCount < MEANS) meanCount++;
+    if (meanCount < MEANS) return event == CLEARED ? CLEARED : NONE;
+
+    float median = medianOfMeans();
+    if (learned) mountHeightCm += TRACK_RATE * (median - mountHeightCm);
+    else mountHeightCm = median;
+    learned = true;
+
+    if (fabs(mountHeightCm - savedCm) >= SAVE_STEP_CM) {
+      StoredMountHeight stored;
+      stored.value.cm = savedCm = mountHeightCm;
+      stored.save();
+    }
+    return event;
+  }
+
+private:
+  float medianOfMeans() const {
+    float v[MEANS];
+    for (uint8_t i = 0; i < MEANS; ++i) {
+      uint8_t j = i;
+      for (; j > 0 && v[j-1] > means[i]; --j) v[j] = v[j-1];
+      v[j] = means[i];
+    }
+    return v[MEANS / 2];
+  }
+};
@@ -0,0 +1,152 @@
+#pragma once
+#include <Arduino.h>
+#include "twi.h"
+
+// --- HD44780 LCD on a PCF8574 Backpack ---
+// P0 = RS, P2 = EN, P3 = backlight, P4..P7 = D4..D7. Every nibble is two
+// expander bytes (EN high, EN low), and a whole screen goes out as one queued
+// TWI write: at 100 kHz each byte outlasts the 37 us HD44780 command time, so
+// no delays are needed and show() returns immediately. Only characters that
+// differ from what the display already shows are sent.
+// Two frame buffers: one on the bus, the other encoded with interrupts on and
+// queued behind it. Handing a frame over is the only atomic step. A frame
+// that fails on the bus leaves the display contents unknown, so the next
+// show() repaints every character.
+template<uint8_t COLS, uint8_t ROWS>
+struct Pcf8574Lcd {
+  static const uint8_t RS = 0x01, EN = 0x04, BACKLIGHT = 0x08;
+  static const uint8_t ROW_BYTES = 4 + 4 * COLS; // set-address command + characters
+
+  Twi *twi = nullptr;
+  TwiRequest *request = nullptr;
+  uint8_t light = BACKLIGHT;
+  uint8_t frames[2][ROWS * ROW_BYTES];
+  char shown[ROWS][COLS];      // display contents once the frame on the bus lands
+  char queuedText[ROWS][COLS]; // display contents after the queued frame
+  volatile uint8_t queuedLength = 0; // frame waiting in the buffer not on the bus
+  volatile bool promoted = false;    // the queued frame has gone on the bus
+  volatile bool damaged = false;     // a frame failed, the next show() repaints
+  bool repaint = false;
+
+  // Blocking HD44780 power-on sequence
+  void begin(Twi &bus, uint8_t address) {
+    twi = &bus;
+    request = twi->acquire(address);
+    if (!request) return;
+    request->done = frameSent;
+    request->context = this;
+    memset(shown, ' ', sizeof(shown));
+    delay(50);
+    nibble(0x30); delayMicroseconds(4500);
+    nibble(0x30); delayMicroseconds(4500);
+    nibble(0x30); delayMicroseconds(150);
+    nibble(0x20); // 4-bit mode
+    command(0x28); // 2 lines, 5x8 font
+    command(0x0C); // Display on, no cursor
+    clear();
+    command(0x06); // Left to right, no shift
+  }
+
+  void backlight() { light = BACKLIGHT; command(0x0C); }
+  void noBacklight() { light = 0; command(0x0C); }
+  void clear() { command(0x01); delayMicroseconds(2000); memset(shown, ' ', sizeof(shown)); }
+
+  // Sends the rows (COLS characters each). A frame still waiting behind the
+  // one on the bus is replaced, so the display skips to the newest rows.
+  void show(const char *const *text) {
+    if (!request) return;
+    uint8_t sreg = SREG;
+    cli();
+    if (queuedLength) queuedLength = 0;
+    else if (promoted) memcpy(shown, queuedText, sizeof(shown));
+    promoted = false;
+    if (damaged) repaint = true;
+    damaged = false;
+    uint8_t *frame = request->tx == frames[0] ? frames[1] : frames[0];
+    SREG = sreg;
+
+    uint8_t length = encodeChanges(frame, text);
+    repaint = false;
+    if (!length) return; // Nothing changed
+
+    cli();
+    bool queued = request->busy();
+    if (queued) {
+      queuedLength = length;
+    } else {
+      request->tx = frame;
+      request->txLength = length;
+      request->rxLength = 0;
+      twi->submit(request);
+    }
+    SREG = sreg;
+    for (uint8_t r = 0; r < ROWS; ++r) memcpy(queued ? queuedText[r] : shown[r], text[r], COLS);
+  }
+
+private:
+  // Interrupt context: starts the queued frame, already encoded. After a
+  // failed frame the queued one, a diff against it, is dropped too.
+  static void frameSent(TwiRequest *r) {
+    Pcf8574Lcd *lcd = (Pcf8574Lcd *)r->context;
+    if (r->status != TwiRequest::OK) {
+      lcd->queuedLength = 0;
+      lcd->damaged = true;
+      return;
+    }
+    if (!lcd->queuedLength) return;
+    r->tx = r->tx == lcd->frames[0] ? lcd->frames[1] : lcd->frames[0];
+    r->txLength = lcd->queuedLength;
+    lcd->queuedLength = 0;
+    lcd->promoted = true;
+    lcd->twi->submit(r);
+  }
+
+  uint8_t encodeChanges(uint8_t *frame, const char *const *text) {
+    uint8_t *p = frame;
+    static const uint8_t rowAddress[4] = { 0x00, 0x40, 0x14, 0x54 };
+    for (uint8_t r = 0; r < ROWS; ++r) {
+      const char *row = text[r];
+      uint8_t c = 0;
+      while (c < COLS) {
+        if (!changed(row, r, c)) { c++; continue; }
+        // A run ends at two unchanged characters in a row: skipping fewer
+        // would cost more than the 4-byte set-address command it saves
+        uint8_t end = c + 1;
+        while (end < COLS && (changed(row, r, end) || (end + 1 < COLS && changed(row, r, end + 1)))) end++;
+        p = encode(p, 0x80 | (rowAddress[r] + c), 0);
+        for (; c < end; ++c) p = encode(p, row[c], RS);
+      }
+    }
+    return p - frame;
+  }
+
+  bool changed(const char *row, uint8_t r, uint8_t c) const { return repaint || row[c] != shown[r][c]; }
+
+  uint8_t *encode(uint8_t *p, uint8_t value, uint8_t mode) {
+    uint8_t high = (value & 0xF0) | light | mode, low = (value << 4) | light | mode;
+    *p++ = high | EN; *p++ = high;
+    *p++ = low | EN; *p++ = low;
+    return p;
+  }
+
+  void write(uint8_t *bytes, uint8_t length) {
+    while (request->busy()) twi->poll();
+    request->tx = bytes;
+    request->txLength = length;
+    request->rxLength = 0;
+    request->done = nullptr;
+    twi->transfer(request);
+    request->done = frameSent;
+  }
+
+  void nibble(uint8_t value) {
+    uint8_t bytes[2] = { (uint8_t)(value | light | EN), (uint8_t)(value | light) };
+    write(bytes, 2);
+  }
+
+  void command(uint8_t value) {
+    uint8_t bytes[4];
+    encode(bytes, value, 0);
+    write(bytes, 4);
+  }
+};
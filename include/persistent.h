@@ -0,0 +1,41 @@
+#pragma once
+#include <Arduino.h>
+#include <EEPROM.h>
+
+// --- Record Validity ---
+// Checks a loaded value beyond the checksum, e.g. for NaN or zero factors.
+// Specialise for a record type; everything else is always valid.
+template<typename T>
+struct PersistentCheck {
+  static bool valid(const T &) { return true; }
+};
+
+// --- Checksummed EEPROM Record ---
+// A value at a fixed address, tagged with a magic number so a blank or
+// foreign EEPROM (all 0xFF, or another layout) is never loaded. The checksum
+// covers the magic and the value; a new magic retires an old layout.
+template<typename T, int ADDR, uint16_t MAGIC>
+struct Persistent {
+  uint16_t magic;
+  T value;
+  uint8_t checksum;
+
+  bool load() {
+    EEPROM.get(ADDR, *this);
+    return magic == MAGIC && checksum == sum() && PersistentCheck<T>::valid(value);
+  }
+
+  void save() {
+    magic = MAGIC;
+    checksum = sum();
+    EEPROM.put(ADDR, *this);
+  }
+
+private:
+  uint8_t sum() const {
+    const uint8_t *bytes = (const uint8_t *)this;
+    uint8_t s = 0x5A;
+    for (uint8_t i = 0; i < offsetof(Persistent, checksum); ++i) s += bytes[i];
+    return s;
+  }
+};
@@ -0,0 +1,77 @@
+#pragma once
+#include <Arduino.h>
+
+// --- Loop Profiling ---
+// Per-stage statistics since boot or the last reset. Normally in micros()
+// (4 us resolution); built with -DPROFILE_CYCLES (env:profile, on the board
+// or under simavr with tools/sim) they are exact CPU cycles from Timer1
+// running at clk/1. Totals stay 32-bit with a separate wrap count, so no
+// 64-bit arithmetic is linked in.
+#ifdef PROFILE_CYCLES
+inline volatile uint16_t &profileOverflows() {
+  static volatile uint16_t overflows = 0; // bumped from ISR(TIMER1_OVF_vect)
+  return overflows;
+}
+
+inline void profileBegin() {
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10); // Free running, no prescaler
+  TIMSK1 = _BV(TOIE1);
+}
+
+inline unsigned long profileNow() {
+  uint8_t sreg = SREG;
+  cli();
+  uint16_t low = TCNT1;
+  uint16_t high = profileOverflows();
+  if ((TIFR1 & _BV(TOV1)) && low < 0x8000) high++; // Overflow not serviced yet
+  SREG = sreg;
+  return (unsigned long)high << 16 | low;
+}
+#define PROFILE_UNIT "cyc"
+#else
+inline void profileBegin() {}
+inline unsigned long profileNow() { return micros(); }
+#define PROFILE_UNIT "us"
+#endif
+
+struct StageTimer {
+  const char *name;
+  unsigned long total = 0;
+  uint16_t totalWraps = 0; // cycle sums wrap every ~4.5 minutes
+  unsigned long worst = 0;
+  unsigned long count = 0;
+  unsigned long started = 0;
+
+  StageTimer(const char *name) : name(name) {}
+
+  void start() { started = profileNow(); }
+
+  void stop() {
+    unsigned long elapsed = profileNow() - started;
+    total += elapsed;
+    if (total < elapsed) totalWraps++;
+    count++;
+    if (elapsed > worst) worst = elapsed;
+  }
+
+  void reset() { total = worst = count = 0; totalWraps = 0; }
+
+  // Float keeps the division 32-bit; exact to a unit for averages below 2^24
+  unsigned long average() const {
+    if (!count) return 0;
+    if (!totalWraps) return total / count;
+    return (totalWraps * 4294967296.0 + total) / count;
+  }
+
+  void print(Print &out) const {
+    out.print(name);
+    out.print(F(": n="));
+    out.print(count);
+    out.print(F(" avg="));
+    out.print(average());
+    out.print(F(PROFILE_UNIT " max="));
+    out.print(worst);
+    out.println(F(PROFILE_UNIT));
+  }
+};
@@ -0,0 +1,261 @@
+#pragma once
+#include <Arduino.h>
+#include "fast_pin.h"
+#include "twi.h"
+
+// --- Ranging Backends ---
+// Each backend has begin() and a non-blocking poll() that returns true when a
+// new distance is available: cm from the sensor, or -1 for no valid target.
+// reading keeps the latest result in the sensor's own unit (0 = none) and
+// toDistance() converts it, so a recorded trace converts exactly the same.
+// onEchoEdge() is the hook for the ultrasonic echo pin-change interrupt.
+
+const float RANGER_MIN_CM = 10.0;
+const float RANGER_MAX_CM = 400.0;
+
+// HC-SR04 ultrasonic. The echo pulse is timed by a pin-change interrupt, so
+// poll() only triggers a ping and later collects the result: the 0.5-30 ms
+// flight time is free for other work. onEchoEdge() must be called from the
+// ECHO pin's PCINT vector; an HX711 read can delay an edge by ~15 us (0.3 cm).
+template<uint8_t TRIG, uint8_t ECHO>
+struct UltrasonicRanger {
+  static constexpr float SOUND_TIME_US_PER_CM = 29.15452;
+  static const unsigned long US_TIMEOUT_US = 30000; // 30ms timeout for ultrasonic pulse
+
+  bool inFlight = false;
+  long reading = 0; // echo time in us
+  unsigned long triggeredUs = 0;
+  volatile unsigned long riseUs = 0;
+  volatile unsigned long echoUs = 0; // 0 until the falling edge
+
+  void begin(Twi &) {
+    FastPin<TRIG>::output();
+    pinMode(ECHO, INPUT);
+    FastPin<ECHO>::enableChangeInterrupt();
+  }
+
+  void onEchoEdge() {
+    unsigned long now = micros();
+    if (FastPin<ECHO>::read()) riseUs = now;
+    else if (riseUs) echoUs = now - riseUs;
+  }
+
+  bool poll(float &distanceCm) {
+    if (!inFlight) {
+      // Trigger ultrasonic sensor
+      riseUs = echoUs = 0;
+      FastPin<TRIG>::low();
+      delayMicroseconds(2);
+      FastPin<TRIG>::high();
+      delayMicroseconds(10);
+      FastPin<TRIG>::low();
+      triggeredUs = micros();
+      inFlight = true;
+      return false;
+    }
+
+    uint8_t sreg = SREG;
+    cli();
+    unsigned long echoTime = echoUs;
+    SREG = sreg;
+    if (!echoTime && micros() - triggeredUs < US_TIMEOUT_US) return false;
+
+    inFlight = false;
+    reading = echoTime;
+    distanceCm = toDistance(reading);
+    return true;
+  }
+
+  static float toDistance(long echoUs) {
+    if (echoUs == 0) return -1; // No echo received (out of range)
+    float cm = echoUs / (SOUND_TIME_US_PER_CM * 2);
+    return cm >= RANGER_MIN_CM && cm <= RANGER_MAX_CM ? cm : -1;
+  }
+
+};
+
+// VL53L1X time-of-flight on the shared interrupt-driven TWI bus. The sensor
+// ranges continuously in the background; each poll() only advances a small
+// request state machine (status -> result -> clear), so the loop never waits
+// for a measurement. The narrow cone also avoids shoulder echoes.
+// Register map and default configuration from ST's VL53L1X ultra-lite driver.
+const uint8_t VL53L1X_DEFAULT_CONFIGURATION[] PROGMEM = {
+  0x00, 0x00, 0x00, 0x01, 0x02, 0x00, 0x02, 0x08, // 0x2D
+  0x00, 0x08, 0x10, 0x01, 0x01, 0x00, 0x00, 0x00, // 0x35
+  0x00, 0xFF, 0x00, 0x0F, 0x00, 0x00, 0x00, 0x00, // 0x3D
+  0x00, 0x20, 0x0B, 0x00, 0x00, 0x02, 0x0A, 0x21, // 0x45
+  0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x00, 0xC8, // 0x4D
+  0x00, 0x00, 0x38, 0xFF, 0x01, 0x00, 0x08, 0x00, // 0x55
+  0x00, 0x01, 0xCC, 0x0F, 0x01, 0xF1, 0x0D, 0x01, // 0x5D
+  0x68, 0x00, 0x80, 0x08, 0xB8, 0x00, 0x00, 0x00, // 0x65
+  0x00, 0x0F, 0x89, 0x00, 0x00, 0x00, 0x00, 0x00, // 0x6D
+  0x00, 0x00, 0x01, 0x0F, 0x0D, 0x0E, 0x0E, 0x00, // 0x75
+  0x00, 0x02, 0xC7, 0xFF, 0x9B, 0x00, 0x00, 0x00, // 0x7D
+  0x01, 0x00, 0x00                                // 0x85
+};
+
+struct Vl53l1xRanger {
+  static const uint8_t ADDRESS = 0x29;
+  static const uint32_t PERIOD_MS = 40; // 25 Hz, with a 33 ms timing budget
+
+  enum Register : uint16_t {
+    VHV_CONFIG__TIMEOUT_MACROP_LOOP_BOUND = 0x0008,
+    CONFIG_START = 0x002D,
+    GPIO__TIO_HV_STATUS = 0x0031,
+    RANGE_CONFIG__TIMEOUT_MACROP_A_HI = 0x005E,
+    RANGE_CONFIG__TIMEOUT_MACROP_B_HI = 0x0061,
+    SYSTEM__INTERMEASUREMENT_PERIOD = 0x006C,
+    SYSTEM__INTERRUPT_CLEAR = 0x0086,
+    SYSTEM__MODE_START = 0x0087,
+    RESULT__RANGE_STATUS = 0x0089,
+    RESULT__OSC_CALIBRATE_VAL = 0x00DE,
+    FIRMWARE__SYSTEM_STATUS = 0x00E5,
+    IDENTIFICATION__MODEL_ID = 0x010F
+  };
+
+  enum State : uint8_t { ABSENT, READY_CHECK, RESULT, CLEAR };
+
+  Twi *twi = nullptr;
+  TwiRequest *request = nullptr;
+  State state = ABSENT;
+  long reading = 0; // mm, 0 without a valid range
+  uint8_t tx[3];
+  uint8_t rx[15]; // RESULT__RANGE_STATUS .. final range (0x0096-0x0097)
+
+  void begin(Twi &bus) {
+    twi = &bus;
+    request = twi->acquire(ADDRESS);
+    if (!request) return;
+    if (configure()) {
+      state = READY_CHECK;
+    } else {
+      twi->release(request); // Back to the pool for the LCD and other sensors
+      request = nullptr;
+    }
+  }
+
+  void onEchoEdge() {}
+
+  bool poll(float &distanceCm) {
+    if (state == ABSENT) {
+      reading = 0;
+      distanceCm = -1;
+      return true;
+    }
+    if (request->busy()) return false;
+    if (request->status != TwiRequest::OK) {
+      state = READY_CHECK; // Retry after a bus error
+      return submitRead(GPIO__TIO_HV_STATUS, 1);
+    }
+
+    switch (state) {
+      case READY_CHECK:
+        if (request->rxLength == 1 && (rx[0] & 1)) {
+          state = RESULT;
+          return submitRead(RESULT__RANGE_STATUS, sizeof(rx));
+        }
+        return submitRead(GPIO__TIO_HV_STATUS, 1);
+      case RESULT: {
+        uint16_t mm = (rx[13] << 8) | rx[14];
+        reading = (rx[0] & 0x1F) == 9 ? mm : 0; // 9 = range valid
+        distanceCm = toDistance(reading);
+        state = CLEAR;
+        tx[0] = SYSTEM__INTERRUPT_CLEAR >> 8;
+        tx[1] = SYSTEM__INTERRUPT_CLEAR & 0xFF;
+        tx[2] = 0x01;
+        request->tx = tx;
+        request->txLength = 3;
+        request->rxLength = 0;
+        twi->submit(request);
+        return true;
+      }
+      default:
+        state = READY_CHECK;
+        return submitRead(GPIO__TIO_HV_STATUS, 1);
+    }
+  }
+
+  static float toDistance(long mm) {
+    float cm = mm / 10.0;
+    return mm && cm >= RANGER_MIN_CM && cm <= RANGER_MAX_CM ? cm : -1;
+  }
+
+private:
+  // Boots and configures the sensor, then starts ranging; false if it is
+  // missing or does not come up
+  bool configure() {
+    uint8_t id[2];
+    if (!read(IDENTIFICATION__MODEL_ID, id, 2) || id[0] != 0xEA) return false;
+    if (!waitForBit(FIRMWARE__SYSTEM_STATUS)) return false; // Booted
+
+    uint8_t config[2 + sizeof(VL53L1X_DEFAULT_CONFIGURATION)];
+    config[0] = CONFIG_START >> 8;
+    config[1] = CONFIG_START & 0xFF;
+    memcpy_P(config + 2, VL53L1X_DEFAULT_CONFIGURATION, sizeof(VL53L1X_DEFAULT_CONFIGURATION));
+    request->tx = config;
+    request->txLength = sizeof(config);
+    request->rxLength = 0;
+    twi->transfer(request);
+
+    // One throw-away measurement calibrates the VHV loop
+    write8(SYSTEM__MODE_START, 0x40);
+    if (!waitForBit(GPIO__TIO_HV_STATUS)) return false;
+    write8(SYSTEM__INTERRUPT_CLEAR, 0x01);
+    write8(SYSTEM__MODE_START, 0x00);
+    write8(VHV_CONFIG__TIMEOUT_MACROP_LOOP_BOUND, 0x09);
+    write8(0x000B, 0x00);
+
+    // Long distance mode is the default; 33 ms timing budget
+    write16(RANGE_CONFIG__TIMEOUT_MACROP_A_HI, 0x00AD);
+    write16(RANGE_CONFIG__TIMEOUT_MACROP_B_HI, 0x00C6);
+    uint8_t osc[2];
+    read(RESULT__OSC_CALIBRATE_VAL, osc, 2);
+    uint16_t clockPll = ((osc[0] << 8) | osc[1]) & 0x3FF;
+    write32(SYSTEM__INTERMEASUREMENT_PERIOD, (uint32_t)(clockPll * PERIOD_MS * 1.075));
+
+    write8(SYSTEM__MODE_START, 0x40); // Continuous ranging
+    return true;
+  }
+
+  bool submitRead(uint16_t reg, uint8_t length) {
+    tx[0] = reg >> 8;
+    tx[1] = reg & 0xFF;
+    request->tx = tx;
+    request->txLength = 2;
+    request->rx = rx;
+    request->rxLength = length;
+    twi->submit(request);
+    return false;
+  }
+
+  // Polls bit 0 of a register for up to ~200 ms
+  bool waitForBit(uint16_t reg) {
+    for (uint8_t tries = 0; tries < 200; ++tries) {
+      if (read(reg, rx, 1) && (rx[0] & 1)) return true;
+      delay(1);
+    }
+    return false;
+  }
+
+  bool read(uint16_t reg, uint8_t *data, uint8_t length) {
+    uint8_t index[2] = { (uint8_t)(reg >> 8), (uint8_t)reg };
+    request->tx = index;
+    request->txLength = 2;
+    request->rx = data;
+    request->rxLength = length;
+    return twi->transfer(request) == TwiRequest::OK;
+  }
+
+  void write(uint16_t reg, uint32_t value, uint8_t length) {
+    uint8_t bytes[6] = { (uint8_t)(reg >> 8), (uint8_t)reg };
+    for (uint8_t i = 0; i < length; ++i) bytes[2 + i] = value >> (8 * (length - 1 - i));
+    request->tx = bytes;
+    request->txLength = 2 + length;
+    request->rxLength = 0;
+    twi->transfer(request);
+  }
+
+  void write8(uint16_t reg, uint8_t value) { write(reg, value, 1); }
+  void write16(uint16_t reg, uint16_t value) { write(reg, value, 2); }
+  void write32(uint16_t reg, uint32_t value) { write(reg, value, 4); }
+};
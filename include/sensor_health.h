@@ -0,0 +1,96 @@
+#pragma once
+#include <Arduino.h>
+
+// --- Sensor Health ---
+// Declares a sensor faulty within a bounded time instead of waiting on it
+// forever:
+//  - scale: SCALE_MISSED_PASSES acquire passes in a row without a usable
+//    conversion (unplugged, DOUT stuck high), or STUCK_CONVERSIONS identical
+//    conversions in a row (DOUT stuck low; real ones always differ in the
+//    low bits);
+//  - ranger: the echo loss rate, a 1/8 exponential average of lost readings,
+//    above ECHO_LOSS_FAULT. A faulty ranger is only retried every
+//    RANGER_RETRY_MS, so passes do not spend 30 ms waiting on dead echoes.
+// Both recover on their own once good readings return.
+struct SensorHealth {
+  static const uint8_t SCALE_MISSED_PASSES = 3;
+  static const uint8_t STUCK_CONVERSIONS = 40;
+  static const uint8_t ECHO_LOSS_FAULT = 230;   // of 255, ~90 %
+  static const uint8_t ECHO_LOSS_RECOVERED = 128;
+  static const unsigned long RANGER_RETRY_MS = 5000;
+
+  enum Event : uint8_t { NONE, SCALE_FAULT, SCALE_OK, RANGER_FAULT, RANGER_OK };
+
+  bool scaleFault = false, rangerFault = false;
+  uint8_t missedPasses = 0, repeats = 0;
+  uint8_t echoLoss = 0;
+  long lastConversion = 0;
+  unsigned long lastRetryMs = 0;
+  unsigned long scaleFaults = 0, rangerFaults = 0;
+
+  // Every conversion read from the scale
+  Event conversion(long value) {
+    if (value == lastConversion) {
+      if (repeats < 255) repeats++;
+    } else {
+      repeats = 0;
+    }
+    lastConversion = value;
+    return updateScale();
+  }
+
+  // End of an acquire pass, with the number of conversions it could use
+  Event scalePass(int used) {
+    if (used) missedPasses = 0;
+    else if (missedPasses < 255) missedPasses++;
+    return updateScale();
+  }
+
+  // Whether this pass should range: always while healthy, else one retry per interval
+  bool rangerDue(unsigned long nowMs) {
+    if (!rangerFault) return true;
+    if (nowMs - lastRetryMs < RANGER_RETRY_MS) return false;
+    lastRetryMs = nowMs;
+    return true;
+  }
+
+  Event echo(bool valid, unsigned long nowMs) {
+    echoLoss += ((valid ? 0 : 255) - (int)echoLoss) / 8;
+    if (!rangerFault && echoLoss > ECHO_LOSS_FAULT) {
+      rangerFault = true;
+      rangerFaults++;
+      lastRetryMs = nowMs;
+      return RANGER_FAULT;
+    }
+    if (rangerFault && valid) {
+      rangerFault = false;
+      echoLoss = ECHO_LOSS_RECOVERED; // A flaky sensor faults again quickly
+      return RANGER_OK;
+    }
+    return NONE;
+  }
+
+  void print(Print &out) const {
+    out.print(F("health: scale "));
+    out.print(scaleFault ? F("FAULT") : F("ok"));
+    out.print(F(" ("));
+    out.print(scaleFaults);
+    out.print(F(" faults), ranger "));
+    out.print(rangerFault ? F("FAULT") : F("ok"));
+    out.print(F(" ("));
+    out.print(rangerFaults);
+    out.print(F(" faults, loss "));
+    out.print(echoLoss * 100 / 255);
+    out.println(F("%)"));
+  }
+
+private:
+  Event updateScale() {
+    bool fault = missedPasses >= SCALE_MISSED_PASSES || repeats >= STUCK_CONVERSIONS;
+    if (fault == scaleFault) return NONE;
+    scaleFault = fault;
+    if (!fault) return SCALE_OK;
+    scaleFaults++;
+    return SCALE_FAULT;
+  }
+};
@@ -0,0 +1,207 @@
+#pragma once
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <SPI.h>
+#include "eeprom_layout.h"
+
+// --- Session Record (6 bytes) ---
+// Circular logs find their write position after a reboot from a 2-bit lap
+// counter in every record: the lap advances (0, 1, 2, 0, ...) each time the
+// log wraps, and 3 is the erased pattern (0xFF) of both EEPROM and flash.
+struct LogRecord {
+  uint16_t delta;   // s since the previous session, saturating
+  uint16_t weight;  // dag
+  uint16_t packed;  // height mm (12 bits) | category (2 bits) | lap (2 bits)
+
+  static const uint8_t LAP_ERASED = 3;
+
+  uint16_t heightMm() const { return packed & 0x0FFF; }
+  uint8_t category() const { return (packed >> 12) & 3; }
+  uint8_t lap() const { return packed >> 14; }
+  void setLap(uint8_t lap) { packed = (packed & 0x3FFF) | ((uint16_t)lap << 14); }
+};
+
+// --- Backends ---
+// A store exposes SLOTS, begin(), read() and a contiguous write().
+
+struct EepromLogStore {
+  static const uint16_t SLOTS = (EEPROM_LOG_END - EEPROM_LOG_START) / sizeof(LogRecord);
+
+  void begin() {}
+
+  void read(uint16_t slot, LogRecord &r) {
+    EEPROM.get(EEPROM_LOG_START + slot * sizeof(LogRecord), r);
+  }
+
+  void write(uint16_t slot, const LogRecord *r, uint8_t n) {
+    int addr = EEPROM_LOG_START + slot * sizeof(LogRecord);
+    const uint8_t *bytes = (const uint8_t *)r;
+    for (uint16_t i = 0; i < n * sizeof(LogRecord); ++i) EEPROM.update(addr + i, bytes[i]); // skips unchanged cells
+  }
+};
+
+// 25-series SPI NOR flash (W25Qxx and compatibles), using the first BYTES of the chip
+template<uint8_t CS, uint32_t BYTES = 65536>
+struct SpiFlashLogStore {
+  static const uint16_t SLOTS = BYTES / sizeof(LogRecord);
+  static const uint16_t PAGE = 256;
+  static const uint16_t SECTOR = 4096;
+
+  void begin() {
+    pinMode(CS, OUTPUT);
+    digitalWrite(CS, HIGH);
+    SPI.begin();
+  }
+
+  void read(uint16_t slot, LogRecord &r) {
+    select(0x03, (uint32_t)slot * sizeof(LogRecord));
+    uint8_t *bytes = (uint8_t *)&r;
+    for (uint8_t i = 0; i < sizeof(LogRecord); ++i) bytes[i] = SPI.transfer(0);
+    deselect();
+  }
+
+  void write(uint16_t slot, const LogRecord *r, uint8_t n) {
+    uint32_t addr = (uint32_t)slot * sizeof(LogRecord);
+    const uint8_t *bytes = (const uint8_t *)r;
+    uint16_t len = n * sizeof(LogRecord);
+    while (len) {
+      // Erase a sector just before the log first writes into it
+      if (addr % SECTOR == 0) command(0x20, addr);
+      // A page program must not cross a page boundary
+      uint16_t chunk = PAGE - addr % PAGE;
+      if (chunk > len) chunk = len;
+      writeEnable();
+      select(0x02, addr);
+      for (uint16_t i = 0; i < chunk; ++i) SPI.transfer(bytes[i]);
+      deselect();
+      waitIdle();
+      addr += chunk; bytes += chunk; len -= chunk;
+    }
+  }
+
+private:
+  void select(uint8_t cmd, uint32_t addr) {
+    SPI.beginTransaction(SPISettings(8000000, MSBFIRST, SPI_MODE0));
+    digitalWrite(CS, LOW);
+    SPI.transfer(cmd);
+    SPI.transfer(addr >> 16);
+    SPI.transfer(addr >> 8);
+    SPI.transfer(addr);
+  }
+
+  void deselect() {
+    digitalWrite(CS, HIGH);
+    SPI.endTransaction();
+  }
+
+  void writeEnable() {
+    SPI.beginTransaction(SPISettings(8000000, MSBFIRST, SPI_MODE0));
+    digitalWrite(CS, LOW);
+    SPI.transfer(0x06);
+    deselect();
+  }
+
+  void command(uint8_t cmd, uint32_t addr) {
+    writeEnable();
+    select(cmd, addr);
+    deselect();
+    waitIdle();
+  }
+
+  void waitIdle() {
+    SPI.beginTransaction(SPISettings(8000000, MSBFIRST, SPI_MODE0));
+    digitalWrite(CS, LOW);
+    SPI.transfer(0x05);
+    while (SPI.transfer(0) & 1); // BUSY bit
+    deselect();
+  }
+};
+
+// --- Circular Session Log ---
+// Records are queued in RAM and written BATCH at a time to save write cycles.
+// A full batch is written when the caller flushes it (the next idle pass) or
+// at the next append, so up to BATCH records are lost on power-off.
+template<typename Store, uint8_t BATCH = 4>
+struct SessionLog {
+  Store store;
+  LogRecord pending[BATCH];
+  uint8_t pendingCount = 0;
+  uint16_t head = 0;   // next slot to write
+  uint8_t lap = 0;     // lap of the record at head
+  unsigned long lastSessionMs = 0;
+
+  void begin() {
+    store.begin();
+    LogRecord r;
+    store.read(0, r);
+    if (r.lap() == LogRecord::LAP_ERASED) return; // empty log
+    // Slots before head carry slot 0's lap, the rest an older lap or are erased
+    uint8_t first = r.lap();
+    uint16_t lo = 1, hi = Store::SLOTS;
+    while (lo < hi) {
+      uint16_t mid = lo + (hi - lo) / 2;
+      store.read(mid, r);
+      if (r.lap() == first) lo = mid + 1; else hi = mid;
+    }
+    head = lo;
+    lap = first;
+    if (head == Store::SLOTS) { head = 0; lap = nextLap(lap); }
+  }
+
+  void append(float weightKg, float heightCm, uint8_t category) {
+    if (pendingCount == BATCH) flush();
+    unsigned long now = millis();
+    unsigned long delta = (now - lastSessionMs) / 1000;
+    lastSessionMs = now;
+
+    LogRecord &r = pending[pendingCount++];
+    r.delta = delta > 0xFFFF ? 0xFFFF : delta;
+    r.weight = weightKg * 100 + 0.5;
+    uint16_t height = heightCm * 10 + 0.5;
+    r.packed = (height & 0x0FFF) | ((uint16_t)(category & 3) << 12);
+  }
+
+  bool batchFull() const { return pendingCount == BATCH; }
+
+  void flush() {
+    uint8_t done = 0;
+    while (done < pendingCount) {
+      // Write up to the end of the store, then wrap to the next lap
+      uint8_t n = pendingCount - done;
+      if (n > Store::SLOTS - head) n = Store::SLOTS - head;
+      for (uint8_t i = 0; i < n; ++i) pending[done + i].setLap(lap);
+      store.write(head, pending + done, n);
+      done += n;
+      head += n;
+      if (head == Store::SLOTS) { head = 0; lap = nextLap(lap); }
+    }
+    pendingCount = 0;
+  }
+
+  // Streams every record, oldest first, as CSV. A full log can take seconds
+  // even at the export baud rate; onRecord (e.g. a watchdog kick) runs
+  // after each record.
+  void exportTo(Print &out, void (*onRecord)() = nullptr) {
+    flush();
+    out.println(F("# delta_s,weight_kg,height_cm,category"));
+    for (uint16_t i = 0; i < Store::SLOTS; ++i) {
+      uint16_t slot = head + i;
+      if (slot >= Store::SLOTS) slot -= Store::SLOTS;
+      LogRecord r;
+      store.read(slot, r);
+      if (r.lap() == LogRecord::LAP_ERASED) continue;
+      out.print(r.delta);
+      out.print(',');
+      out.print(r.weight / 100.0);
+      out.print(',');
+      out.print(r.heightMm() / 10.0, 1);
+      out.print(',');
+      out.println(r.category());
+      if (onRecord) onRecord();
+    }
+    out.println(F("# end"));
+  }
+
+private:
+  static uint8_t nextLap(uint8_t lap) { return lap == 2 ? 0 : lap + 1; }
+};
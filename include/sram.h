@@ -0,0 +1,68 @@
+#pragma once
+#include <Arduino.h>
+
+// --- SRAM Budget ---
+// Everything between the end of .data/.bss and the top of RAM is painted
+// with STACK_CANARY before main() runs (paintStack() in main.cpp). The stack
+// grows down into the paint, so the bytes still painted above the static
+// data are the stack's unused reserve since reset. Nothing calls malloc,
+// so there is no heap between the two.
+const uint8_t STACK_CANARY = 0xC5;
+const uint8_t STACK_GUARD_BYTES = 64; // Warn when the stack comes this close
+
+#ifdef __AVR__
+extern uint8_t _end;    // end of .data + .bss
+extern uint8_t __stack; // RAMEND
+
+inline uint16_t staticBytes() { return (uint16_t)(uintptr_t)&_end - RAMSTART; }
+inline uint16_t stackBytesNow() { return (uint16_t)(uintptr_t)&__stack - SP; }
+inline uint16_t stackSpan() { return &__stack - &_end + 1; } // painted at reset
+
+// Painted bytes left above the static data; 0 means the stack reached it
+inline uint16_t stackReserve() {
+  const uint8_t *p = &_end;
+  while (p <= &__stack && *p == STACK_CANARY) ++p;
+  return p - &_end;
+}
+
+// One-byte probe, cheap enough for every loop pass
+inline bool stackNearLimit() { return (&_end)[STACK_GUARD_BYTES] != STACK_CANARY; }
+#else
+// Native build: host/core.cpp paints the stack below main() the same way
+// (hostPaintStack()). There is no linker map of the firmware's own data, so
+// static is left to the object list, all in host sizes (8-byte pointers and
+// longs), which overstates the board.
+uint16_t hostStackBytesNow();
+uint16_t hostStackSpan();
+uint16_t hostStackReserve();
+inline uint16_t stackBytesNow() { return hostStackBytesNow(); }
+inline uint16_t stackSpan() { return hostStackSpan(); }
+inline uint16_t stackReserve() { return hostStackReserve(); }
+inline bool stackNearLimit() { return hostStackSpan() && hostStackReserve() < STACK_GUARD_BYTES; }
+#endif
+
+inline uint16_t printSramItem(Print &out, const __FlashStringHelper *name, uint16_t bytes) {
+  out.print(F("  "));
+  out.print(name);
+  out.print(F(": "));
+  out.println(bytes);
+  return bytes;
+}
+
+inline void printSram(Print &out) {
+  uint16_t reserve = stackReserve();
+  out.print(F("SRAM "));
+  out.print(RAMEND - RAMSTART + 1);
+#ifdef __AVR__
+  out.print(F(": static "));
+  out.print(staticBytes());
+  out.print(F(", stack now "));
+#else
+  out.print(F(", host sizes: stack now "));
+#endif
+  out.print(stackBytesNow());
+  out.print(F(", stack max "));
+  out.print(stackSpan() - reserve);
+  out.print(F(", never used "));
+  out.println(reserve);
+}
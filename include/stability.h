@@ -0,0 +1,156 @@
+#pragma once
+#include <Arduino.h>
+
+// --- Stability Policies ---
+// How one channel (weight or height) of the sample history decides it has
+// settled. StabilityTracker takes the policy as a template parameter, so the
+// choice is made at compile time and inlines without virtual calls.
+//
+// update() runs once per new sample with the tolerance in history units
+// (dag or mm) and the number of stable readings required. It returns false
+// when the newest sample moved, and sets stable once the channel has settled.
+// All policies treat a jump of more than the tolerance between the two
+// newest samples, or platform sway, as movement.
+
+// Consecutive pairs within the tolerance; any movement restarts the count
+struct ConsecutiveDeltaPolicy {
+  int count = 0;
+  bool stable = false;
+
+  template<typename History>
+  bool update(const History &history, typename History::Field f, int16_t tolerance, uint8_t required, bool swaying) {
+    bool still = !swaying && history.size() >= 2 &&
+                 abs(History::value(history.at(0), f) - History::value(history.at(1), f)) <= tolerance;
+    count = still ? min(count + 1, 1000) : 0;
+    stable = count >= required;
+    return still;
+  }
+
+  void reset() { count = 0; stable = false; }
+};
+
+// Base for the policies that judge the newest required + 1 samples as a
+// whole; only samples since the last reset or sway count towards it
+struct WindowPolicy {
+  uint8_t run = 0; // samples since the last reset or sway
+  bool stable = false;
+
+  template<typename History>
+  bool step(const History &history, typename History::Field f, int16_t tolerance, bool swaying) {
+    bool still = !swaying && history.size() >= 2 &&
+                 abs(History::value(history.at(0), f) - History::value(history.at(1), f)) <= tolerance;
+    if (swaying) run = 0;
+    else if (run < 255) run++;
+    return still;
+  }
+
+  // Window length once enough samples have arrived, 0 before
+  template<typename History>
+  uint8_t window(const History &history, uint8_t required) const {
+    uint8_t n = required < History::capacity() ? required + 1 : History::capacity();
+    return run >= n && history.size() >= n ? n : 0;
+  }
+
+  void reset() { run = 0; stable = false; }
+};
+
+// Spread of the window (max - min) within the tolerance: bounds slow drift,
+// which consecutive pairs alone let through
+struct WindowedRangePolicy : WindowPolicy {
+  template<typename History>
+  bool update(const History &history, typename History::Field f, int16_t tolerance, uint8_t required, bool swaying) {
+    bool still = step(history, f, tolerance, swaying);
+    uint8_t n = window(history, required);
+    stable = n && history.maximum(f, n) - history.minimum(f, n) <= tolerance;
+    return still;
+  }
+};
+
+// Standard deviation of the window within half the tolerance: a single
+// outlier does not restart the wait the way it does for consecutive pairs
+struct WindowedVariancePolicy : WindowPolicy {
+  template<typename History>
+  bool update(const History &history, typename History::Field f, int16_t tolerance, uint8_t required, bool swaying) {
+    bool still = step(history, f, tolerance, swaying);
+    uint8_t n = window(history, required);
+    stable = false;
+    if (!n) return still;
+
+    long sum = 0;
+    for (uint8_t i = 0; i < n; ++i) sum += History::value(history.at(i), f);
+    int16_t mean = sum / n;
+    unsigned long squares = 0;
+    for (uint8_t i = 0; i < n; ++i) {
+      long d = History::value(history.at(i), f) - mean;
+      if (d > 4095 || d < -4095) d = 4095; // Keeps the sum inside 32 bits
+      squares += d * d;
+    }
+    // sd <= tolerance / 2  <=>  4 * sum(d^2) <= tolerance^2 * n
+    stable = 4 * squares <= (unsigned long)tolerance * tolerance * n;
+    return still;
+  }
+};
+
+// Least-squares line through the window: settled when the fitted trend moves
+// less than half the tolerance across the window and no sample is further
+// than the tolerance from the line. Catches a person still shifting slowly.
+struct ModelPolicy : WindowPolicy {
+  template<typename History>
+  bool update(const History &history, typename History::Field f, int16_t tolerance, uint8_t required, bool swaying) {
+    bool still = step(history, f, tolerance, swaying);
+    uint8_t n = window(history, required);
+    stable = false;
+    if (!n) return still;
+
+    // x = age, centred so the slope and intercept decouple
+    float xMean = (n - 1) / 2.0, yMean = 0;
+    for (uint8_t i = 0; i < n; ++i) yMean += History::value(history.at(i), f);
+    yMean /= n;
+    float sxy = 0, sxx = 0;
+    for (uint8_t i = 0; i < n; ++i) {
+      float dx = i - xMean;
+      sxy += dx * (History::value(history.at(i), f) - yMean);
+      sxx += dx * dx;
+    }
+    float slope = sxy / sxx;
+    if (fabs(slope * (n - 1)) * 2 > tolerance) return still;
+    for (uint8_t i = 0; i < n; ++i) {
+      float residual = History::value(history.at(i), f) - (yMean + slope * (i - xMean));
+      if (fabs(residual) > tolerance) return still;
+    }
+    stable = true;
+    return still;
+  }
+};
+
+// --- Noise Floor ---
+// Sensor noise measured while the platform is empty, as the mean absolute
+// difference between consecutive samples (history units x 16). Early on it
+// is a plain average, then a 1/16 exponential one so it follows drift.
+// For Gaussian noise the pair difference sd is ~1.25x that mean.
+struct NoiseFloor {
+  static const uint8_t MIN_SAMPLES = 16;
+
+  uint16_t mad16 = 0;
+  uint8_t samples = 0;
+
+  void add(int16_t delta) {
+    long d = (long)min(abs(delta), 2047) * 16;
+    if (samples < MIN_SAMPLES) mad16 = (mad16 * (long)samples + d) / (samples + 1);
+    else mad16 += (d - (long)mad16) / 16;
+    if (samples < 255) samples++;
+  }
+
+  bool known() const { return samples >= MIN_SAMPLES; }
+
+  // Largest pair difference within sigmas standard deviations, history units
+  int16_t tolerance(uint8_t sigmas) const { return ((long)mad16 * sigmas * 5 + 63) / 64; }
+
+  // Samples whose mean is within limit of the true value at sigmas standard
+  // errors: n >= (sigmas * sd / limit)^2, with the sample sd = pair sd / sqrt(2)
+  uint8_t samplesWithin(int16_t limit, uint8_t sigmas) const {
+    long spread = tolerance(sigmas), l = limit > 1 ? limit : 1;
+    long n = (spread * spread + 2 * l * l - 1) / (2 * l * l);
+    return n > 255 ? 255 : n;
+  }
+};
@@ -0,0 +1,42 @@
+#pragma once
+#include <Arduino.h>
+
+// --- Streaming Zero ---
+// Finds the scale zero from the conversions the loop reads anyway, instead
+// of a blocking tare: WINDOW conversions in a row whose spread stays within
+// a limit are averaged; a wider spread (someone on the platform, a knock)
+// restarts the window.
+template<uint8_t CHANNELS>
+struct StreamingZero {
+  static const uint8_t WINDOW = 16; // 0.2 s at 80 SPS
+
+  bool done = false;
+  uint8_t count = 0;
+  long sum = 0, low = 0, high = 0;
+  long channelSum[CHANNELS];
+
+  // Returns true once the window is complete
+  bool add(long value, const long *raw, long maxSpread) {
+    if (done) return false;
+    if (count == 0 || value < low) low = value;
+    if (count == 0 || value > high) high = value;
+    if (high - low > maxSpread) {
+      restart();
+      return add(value, raw, maxSpread);
+    }
+    if (count == 0) {
+      sum = 0;
+      memset(channelSum, 0, sizeof(channelSum));
+    }
+    sum += value;
+    for (uint8_t c = 0; c < CHANNELS; ++c) channelSum[c] += raw[c];
+    if (++count < WINDOW) return false;
+    done = true;
+    return true;
+  }
+
+  void restart() { count = 0; }
+
+  long offset() const { return sum / WINDOW; }
+  long channelOffset(uint8_t c) const { return channelSum[c] / WINDOW; }
+};
@@ -0,0 +1,58 @@
+#pragma once
+#include <Arduino.h>
+
+// --- Centre-of-Pressure Sway ---
+// Four corner loads give the centre of pressure (CoP) on the platform; its
+// speed shows leaning and shifting even when the total weight is steady.
+// All integer: loads are raw counts above zero, CoP in mm from the centre,
+// speed in mm/s smoothed by a 1/4 exponential average.
+// Channel order: 0 front-left, 1 front-right, 2 back-right, 3 back-left.
+struct SwayEstimator {
+  static const int16_t HALF_WIDTH_MM = 200; // cell spacing / 2, left-right
+  static const int16_t HALF_DEPTH_MM = 200; // cell spacing / 2, front-back
+  static const uint8_t LOAD_SHIFT = 8;      // keeps load * mm inside 32 bits
+
+  bool valid = false;
+  int16_t x = 0, y = 0;       // mm, +x right, +y front
+  uint16_t speed = 0;         // mm/s, smoothed
+  uint8_t updates = 0;        // speed estimates since the load appeared
+  unsigned long lastMs = 0;
+
+  // counts are per-channel raw counts relative to each channel's zero;
+  // minTotal is the smallest summed load (in counts) worth tracking
+  void update(const long *counts, uint8_t channels, unsigned long nowMs, long minTotal) {
+    if (channels != 4) return;
+    long c[4];
+    for (uint8_t i = 0; i < 4; ++i) c[i] = counts[i] >> LOAD_SHIFT;
+    long total = c[0] + c[1] + c[2] + c[3];
+    if (labs(total) < (minTotal >> LOAD_SHIFT) || total == 0) { reset(); return; }
+
+    // The ratios cancel the sign of the load cell wiring
+    int16_t nx = (long)(c[1] + c[2] - c[0] - c[3]) * HALF_WIDTH_MM / total;
+    int16_t ny = (long)(c[0] + c[1] - c[2] - c[3]) * HALF_DEPTH_MM / total;
+
+    if (valid) {
+      unsigned long dt = nowMs - lastMs;
+      if (dt == 0) return;
+      uint16_t moved = abs(nx - x) + abs(ny - y); // Manhattan distance, close enough and no sqrt
+      long v = (long)moved * 1000 / dt;
+      if (v > 0xFFFF) v = 0xFFFF;
+      speed += ((long)v - speed) / 4;
+      if (updates < 255) updates++;
+    }
+    x = nx;
+    y = ny;
+    lastMs = nowMs;
+    valid = true;
+  }
+
+  // Speed is meaningful once the average has seen a few steps
+  bool moving(uint16_t limit) const { return valid && speed > limit; }
+  bool still(uint16_t limit) const { return valid && updates >= 3 && speed <= limit; }
+
+  void reset() {
+    valid = false;
+    speed = 0;
+    updates = 0;
+  }
+};
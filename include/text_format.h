@@ -0,0 +1,33 @@
+#pragma once
+#include <Arduino.h>
+
+// --- Fixed-Width Number Formatting ---
+// Writes value right-aligned into exactly width chars (space padded, no
+// terminator), with decimals digits after the point: value 225 with one
+// decimal is "22.5". 16-bit arithmetic only, so it replaces snprintf and
+// dtostrf without their libc code or a scratch buffer. A value that does
+// not fit fills the field with '#'. Returns the first non-space char.
+inline char *formatDecimal(char *out, uint8_t width, int value, uint8_t decimals = 0) {
+  bool negative = value < 0;
+  unsigned int v = negative ? -(unsigned int)value : value;
+
+  uint8_t digits = 1;
+  for (unsigned int t = v / 10; t; t /= 10) digits++;
+  if (digits <= decimals) digits = decimals + 1; // leading zero, "0.5"
+  uint8_t needed = digits + (decimals ? 1 : 0) + (negative ? 1 : 0);
+  if (needed > width) {
+    memset(out, '#', width);
+    return out;
+  }
+
+  char *p = out + width;
+  for (uint8_t i = 0; i < digits; ++i) {
+    if (decimals && i == decimals) *--p = '.';
+    *--p = '0' + v % 10;
+    v /= 10;
+  }
+  if (negative) *--p = '-';
+  char *start = p;
+  while (p > out) *--p = ' ';
+  return start;
+}
@@ -0,0 +1,326 @@
+#pragma once
+#include <Arduino.h>
+#include "twi.h"
+#include "hx711_fast.h"
+
+// --- Sensor Trace Capture and Replay ---
+// Records the raw readings as they enter the pipeline: HX711 counts per
+// channel and the ranger's native reading (echo us or ToF mm, 0 = none), each
+// with the microseconds since the previous record. Counts are zigzag delta
+// coded as varints, so a four-cell 80 SPS capture needs ~1 kB/s of serial.
+// A STATE record carries the zero, factor, trims and mount height the
+// readings were taken with, so a replay starts from the same calibration.
+//
+// Frame: TRACE_SYNC, payload length, payload (type, dt varint, values...).
+// While a trace is captured the monitor text goes out in TEXT frames too
+// (TraceMonitor), so the port carries nothing but frames.
+//
+// Replay flow control: the reader sends TRACE_ACK for every frame it has
+// taken out of the UART, and the sender (tools/trace.py) keeps at most
+// TRACE_WINDOW unacknowledged bytes in flight, what the receive buffer holds.
+
+const uint8_t TRACE_SYNC = 0xA5;
+const uint8_t TRACE_ACK = 0x06;
+const uint8_t TRACE_WINDOW = 63; // HardwareSerial's 64-byte ring holds 63
+
+enum TraceType : uint8_t { TRACE_NONE, TRACE_SCALE, TRACE_RANGE, TRACE_STATE, TRACE_TEXT };
+
+inline uint8_t traceVarint(uint8_t *out, uint32_t v) {
+  uint8_t n = 0;
+  while (v >= 0x80) {
+    out[n++] = (uint8_t)v | 0x80;
+    v >>= 7;
+  }
+  out[n++] = (uint8_t)v;
+  return n;
+}
+
+inline uint32_t traceZigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+inline int32_t traceUnzigzag(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+inline uint32_t traceFloatBits(float f) { uint32_t v; memcpy(&v, &f, 4); return v; }
+inline float traceBitsFloat(uint32_t v) { float f; memcpy(&f, &v, 4); return f; }
+
+// Largest payload: STATE with type, dt, offset, factor, mount height and
+// an offset and trim per channel, 5 bytes per varint at most
+template<uint8_t CHANNELS>
+struct TraceFrame {
+  static const uint8_t MAX_PAYLOAD = 1 + 5 * (4 + 2 * CHANNELS);
+  static const uint8_t MAX_TEXT = MAX_PAYLOAD - 6; // after the type and dt
+  static_assert(2 + MAX_PAYLOAD <= TRACE_WINDOW, "a frame must fit the replay window");
+};
+
+template<typename Scale>
+struct TraceWriter {
+  static const uint8_t CHANNELS = Scale::CHANNELS;
+
+  Print *out = nullptr;
+  unsigned long lastUs = 0;
+  long lastRaw[CHANNELS];
+  long lastReading = 0;
+
+  bool active() const { return out; }
+
+  void begin(Print &stream) {
+    out = &stream;
+    lastUs = micros();
+    memset(lastRaw, 0, sizeof(lastRaw));
+    lastReading = 0;
+  }
+
+  void end() { out = nullptr; }
+
+  void scale(const long *raw) {
+    if (!out) return;
+    uint8_t frame[2 + TraceFrame<CHANNELS>::MAX_PAYLOAD];
+    uint8_t n = header(frame, TRACE_SCALE);
+    for (uint8_t c = 0; c < CHANNELS; ++c) {
+      n += traceVarint(frame + n, traceZigzag(raw[c] - lastRaw[c]));
+      lastRaw[c] = raw[c];
+    }
+    send(frame, n);
+  }
+
+  void range(long reading) {
+    if (!out) return;
+    uint8_t frame[2 + 1 + 5 + 5];
+    uint8_t n = header(frame, TRACE_RANGE);
+    n += traceVarint(frame + n, traceZigzag(reading - lastReading));
+    lastReading = reading;
+    send(frame, n);
+  }
+
+  void state(const Scale &scale, float mountHeightCm) {
+    if (!out) return;
+    uint8_t frame[2 + TraceFrame<CHANNELS>::MAX_PAYLOAD];
+    uint8_t n = header(frame, TRACE_STATE);
+    n += traceVarint(frame + n, traceZigzag(scale.offset));
+    n += traceVarint(frame + n, traceFloatBits(scale.factor));
+    n += traceVarint(frame + n, traceFloatBits(mountHeightCm));
+    for (uint8_t c = 0; c < CHANNELS; ++c) {
+      n += traceVarint(frame + n, traceZigzag(scale.channelOffset[c]));
+      n += traceVarint(frame + n, traceFloatBits(scale.trim[c]));
+    }
+    send(frame, n);
+  }
+
+  // Monitor text, up to MAX_TEXT characters. Its dt is informational and
+  // does not move the timeline the sensor records are paced on.
+  void text(const char *chars, uint8_t length) {
+    if (!out) return;
+    uint8_t frame[2 + TraceFrame<CHANNELS>::MAX_PAYLOAD];
+    unsigned long lastRecordUs = lastUs;
+    uint8_t n = header(frame, TRACE_TEXT);
+    lastUs = lastRecordUs;
+    memcpy(frame + n, chars, length);
+    send(frame, n + length);
+  }
+
+private:
+  uint8_t header(uint8_t *frame, TraceType type) {
+    unsigned long now = micros();
+    frame[2] = type;
+    uint8_t n = 3 + traceVarint(frame + 3, now - lastUs);
+    lastUs = now;
+    return n;
+  }
+
+  void send(uint8_t *frame, uint8_t n) {
+    frame[0] = TRACE_SYNC;
+    frame[1] = n - 2;
+    out->write(frame, n);
+  }
+};
+
+// Decodes frames from a stream and applies each record at its recorded
+// time, measured from begin(). Like the sensors themselves it keeps only the
+// latest scale and range reading: one not taken before the next of its kind
+// comes due is lost, as an HX711 conversion is when nobody clocks it out. A
+// loop pause therefore costs replay the same conversions it costs the board,
+// and the person on the trace keeps moving meanwhile. Reads from the stream
+// only while no complete frame is waiting for its time, and acknowledges each
+// frame once its last byte is out of the stream.
+template<typename Scale>
+struct TraceReader {
+  static const uint8_t CHANNELS = Scale::CHANNELS;
+  enum State : uint8_t { SYNC, LENGTH, PAYLOAD };
+
+  Stream *in = nullptr;
+  Scale *scale = nullptr;         // zero, factor and trims follow STATE records
+  float *mountHeightCm = nullptr;
+  State state = SYNC;
+  uint8_t length = 0, index = 0;
+  uint8_t payload[TraceFrame<CHANNELS>::MAX_PAYLOAD];
+  bool held = false; // payload is a complete frame not yet due
+
+  unsigned long startUs = 0, traceUs = 0; // trace time of the last applied record
+  long raw[CHANNELS];
+  long reading = 0;
+  bool scaleReady = false, rangeReady = false;
+
+  void begin(Stream &stream, Scale &target, float &mountHeight) {
+    in = &stream;
+    scale = &target;
+    mountHeightCm = &mountHeight;
+    memset(raw, 0, sizeof(raw));
+    startUs = micros();
+  }
+
+  // Applies the records that are due; true while a reading of type
+  // (TRACE_SCALE or TRACE_RANGE) is waiting to be taken
+  bool ready(TraceType type) {
+    poll();
+    return type == TRACE_SCALE ? scaleReady : rangeReady;
+  }
+
+  void take(TraceType type) {
+    if (type == TRACE_SCALE) scaleReady = false;
+    else rangeReady = false;
+  }
+
+private:
+  void poll() {
+    for (;;) {
+      while (!held && in && in->available()) receive(in->read());
+      if (!held) return;
+      const uint8_t *p = payload + 1;
+      unsigned long dt = readVarint(p);
+      if (payload[0] < TRACE_SCALE || payload[0] > TRACE_STATE) {
+        held = false; // Text or unknown record, its dt is not on the timeline
+        continue;
+      }
+      if ((long)(micros() - startUs - traceUs - dt) < 0) return; // Not due yet
+      traceUs += dt;
+      held = false;
+      apply(p);
+    }
+  }
+
+  void apply(const uint8_t *p) {
+    switch (payload[0]) {
+      case TRACE_SCALE:
+        for (uint8_t c = 0; c < CHANNELS; ++c) raw[c] += traceUnzigzag(readVarint(p));
+        scaleReady = true;
+        break;
+      case TRACE_RANGE:
+        reading += traceUnzigzag(readVarint(p));
+        rangeReady = true;
+        break;
+      default:
+        scale->offset = traceUnzigzag(readVarint(p));
+        scale->factor = traceBitsFloat(readVarint(p));
+        *mountHeightCm = traceBitsFloat(readVarint(p));
+        for (uint8_t c = 0; c < CHANNELS; ++c) {
+          scale->channelOffset[c] = traceUnzigzag(readVarint(p));
+          scale->trim[c] = traceBitsFloat(readVarint(p));
+        }
+        break;
+    }
+  }
+
+  void receive(uint8_t b) {
+    switch (state) {
+      case SYNC:
+        if (b == TRACE_SYNC) state = LENGTH;
+        break;
+      case LENGTH:
+        length = b;
+        index = 0;
+        state = length && length <= sizeof(payload) ? PAYLOAD : SYNC;
+        break;
+      case PAYLOAD:
+        payload[index++] = b;
+        if (index < length) break;
+        state = SYNC;
+        in->write(TRACE_ACK);
+        held = true;
+        break;
+    }
+  }
+
+  uint32_t readVarint(const uint8_t *&p) {
+    uint32_t v = 0;
+    for (uint8_t shift = 0; p < payload + length && shift < 35; shift += 7) {
+      uint8_t b = *p++;
+      v |= (uint32_t)(b & 0x7F) << shift;
+      if (!(b & 0x80)) break;
+    }
+    return v;
+  }
+};
+
+// --- Monitor Text ---
+// Print for everything meant for the serial monitor: straight to the port,
+// or line by line into TEXT frames while a trace is being captured.
+template<typename Writer>
+struct TraceMonitor : Print {
+  Writer &trace;
+  Print &port;
+  char line[TraceFrame<Writer::CHANNELS>::MAX_TEXT];
+  uint8_t length = 0;
+
+  TraceMonitor(Writer &trace, Print &port) : trace(trace), port(port) {}
+
+  size_t write(uint8_t b) override {
+    if (!trace.active()) return port.write(b);
+    line[length++] = b;
+    if (b == '\n' || length == sizeof(line)) endLine();
+    return 1;
+  }
+  using Print::write;
+
+  // Sends a partial line, e.g. before the capture ends
+  void endLine() {
+    if (length) trace.text(line, length);
+    length = 0;
+  }
+};
+
+// --- Replay Backends ---
+// Drop-in Scale and Ranger types that take their readings from a trace
+// instead of the hardware. ReplayScale shares HX711Units with the driver, so
+// read_average(), get_units() and tare() all read through the trace. Tare and
+// gain changes do not consume records: the zero and factor come from the
+// trace's STATE records.
+template<typename Base>
+struct ReplayScale : HX711Units<ReplayScale<Base>, Base::CHANNELS> {
+  TraceReader<ReplayScale> *trace = nullptr;
+
+  void attach(TraceReader<ReplayScale> &reader) { trace = &reader; }
+
+  void begin(uint8_t = 128) {}
+
+  bool is_ready() { return trace && trace->ready(TRACE_SCALE); }
+
+  void wait_ready() { while (!is_ready()) yield(); }
+
+  void set_gain(uint8_t = 128) {}
+
+  long read() {
+    wait_ready();
+    memcpy(this->raw, trace->raw, sizeof(this->raw));
+    trace->take(TRACE_SCALE);
+    return this->trimmedSum();
+  }
+
+  void tare(uint8_t = 10) {}
+};
+
+// Base supplies toDistance(), so replayed readings convert exactly as live ones
+template<typename Base, typename Scale>
+struct ReplayRanger {
+  TraceReader<Scale> *trace = nullptr;
+  long reading = 0;
+
+  void attach(TraceReader<Scale> &reader) { trace = &reader; }
+  void begin(Twi &) {}
+  void onEchoEdge() {}
+
+  bool poll(float &distanceCm) {
+    if (!trace || !trace->ready(TRACE_RANGE)) return false;
+    reading = trace->reading;
+    trace->take(TRACE_RANGE);
+    distanceCm = Base::toDistance(reading);
+    return true;
+  }
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+// --- Pipeline Tuning ---
+// The parameters that trade time-to-result against accuracy. Builds can
+// point TUNING_HEADER at another file with the same constants, e.g.
+// -DTUNING_HEADER='"tuning_tuned.h"', the header tools/autotune.py writes
+// after searching these values over replayed traces (env:native).
+// STABILITY_POLICY picks the stability.h policy the same way, or from the
+// command line: -DSTABILITY_POLICY=WindowedVariancePolicy.
+#ifdef TUNING_HEADER
+#include TUNING_HEADER
+#else
+const float WEIGHT_TOLERANCE_KG = 2.0; // Maximum weight difference for stability
+const float HEIGHT_TOLERANCE_CM = 3.0; // Maximum height difference for stability
+const int STABLE_READINGS_REQUIRED = 5; // Number of consecutive stable readings needed
+const int SCALE_SAMPLES = 5; // Average over 5 readings (at 10 SPS)
+const unsigned long LOOP_DELAY_MS = 500;
+#endif
+
+#ifndef STABILITY_POLICY
+#define STABILITY_POLICY ConsecutiveDeltaPolicy // Or WindowedRangePolicy, WindowedVariancePolicy, ModelPolicy
+#endif
@@ -0,0 +1,185 @@
+#pragma once
+#include <Arduino.h>
+#include <util/twi.h>
+#include "fast_pin.h"
+
+// --- Interrupt-Driven TWI ---
+// Requests come from a static pool and are queued FIFO; the TWI interrupt runs
+// each one (write tx, then read rx after a repeated start) and starts the next,
+// so bus transfers overlap with HX711 reads and ranging. The owner must keep
+// the buffers alive until the request is no longer PENDING.
+// done() runs in interrupt context: keep it short.
+// A request still in progress after TIMEOUT_MS means a slave holds the bus
+// (SDA stuck low after a glitch or a reset mid-byte): poll() then clocks SCL
+// until SDA is released, sends a STOP and fails the request with ERROR.
+struct TwiRequest {
+  enum Status : uint8_t { FREE, IDLE, PENDING, OK, NACK, ERROR };
+
+  uint8_t address;
+  const uint8_t *tx = nullptr;
+  uint8_t txLength = 0;
+  uint8_t *rx = nullptr;
+  uint8_t rxLength = 0;
+  void (*done)(TwiRequest *) = nullptr;
+  void *context = nullptr; // for done()
+  volatile Status status = FREE;
+  TwiRequest *next = nullptr;
+
+  bool busy() const { return status == PENDING; }
+};
+
+struct Twi {
+  static const uint8_t POOL = 4;
+  static const uint8_t TIMEOUT_MS = 25; // 2x the longest request, a full LCD frame
+  typedef FastPin<18> Sda; // A4
+  typedef FastPin<19> Scl; // A5
+
+  TwiRequest pool[POOL];
+  TwiRequest *volatile head = nullptr; // in progress
+  TwiRequest *volatile tail = nullptr;
+  uint8_t index = 0;
+  bool reading = false;
+  unsigned long startedMs = 0; // when head started
+  unsigned long errors = 0, timeouts = 0;
+
+  static const uint8_t CONTROL = _BV(TWEN) | _BV(TWIE) | _BV(TWINT);
+
+  void begin(unsigned long frequency = 100000) {
+    PORTC |= _BV(4) | _BV(5); // Weak pull-ups on SDA/SCL
+    TWSR = 0;
+    TWBR = (F_CPU / frequency - 16) / 2;
+    TWCR = _BV(TWEN);
+  }
+
+  // Requests are owned for the lifetime of their user; nullptr when the pool is empty
+  TwiRequest *acquire(uint8_t address) {
+    for (uint8_t i = 0; i < POOL; ++i) {
+      if (pool[i].status != TwiRequest::FREE) continue;
+      pool[i].status = TwiRequest::IDLE;
+      pool[i].address = address;
+      return &pool[i];
+    }
+    return nullptr;
+  }
+
+  void release(TwiRequest *r) { r->status = TwiRequest::FREE; }
+
+  void submit(TwiRequest *r) {
+    r->status = TwiRequest::PENDING;
+    r->next = nullptr;
+    uint8_t sreg = SREG;
+    cli();
+    if (head) {
+      tail->next = r;
+      tail = r;
+    } else {
+      head = tail = r;
+      start();
+    }
+    SREG = sreg;
+  }
+
+  // Blocking submit for set-up code; returns the final status
+  TwiRequest::Status transfer(TwiRequest *r) {
+    submit(r);
+    while (r->busy()) poll();
+    return r->status;
+  }
+
+  // Main context, at least once per loop pass: recovers a stuck bus
+  void poll() {
+    uint8_t sreg = SREG;
+    cli();
+    if (head && millis() - startedMs > TIMEOUT_MS) {
+      timeouts++;
+      recover();
+      finish(TwiRequest::ERROR);
+    }
+    SREG = sreg;
+  }
+
+  // Called from ISR(TWI_vect)
+  void isr() {
+    TwiRequest *r = head;
+    switch (TW_STATUS) {
+      case TW_START:
+      case TW_REP_START:
+        index = 0;
+        TWDR = (r->address << 1) | (reading ? TW_READ : TW_WRITE);
+        TWCR = CONTROL;
+        break;
+      case TW_MT_SLA_ACK:
+      case TW_MT_DATA_ACK:
+        if (index < r->txLength) {
+          TWDR = r->tx[index++];
+          TWCR = CONTROL;
+        } else if (r->rxLength) {
+          reading = true;
+          TWCR = CONTROL | _BV(TWSTA);
+        } else {
+          finish(TwiRequest::OK);
+        }
+        break;
+      case TW_MR_SLA_ACK:
+        TWCR = r->rxLength > 1 ? CONTROL | _BV(TWEA) : CONTROL;
+        break;
+      case TW_MR_DATA_ACK:
+        r->rx[index++] = TWDR;
+        TWCR = index + 1 < r->rxLength ? CONTROL | _BV(TWEA) : CONTROL; // NACK the last byte
+        break;
+      case TW_MR_DATA_NACK:
+        r->rx[index++] = TWDR;
+        finish(TwiRequest::OK);
+        break;
+      case TW_MT_SLA_NACK:
+      case TW_MT_DATA_NACK:
+      case TW_MR_SLA_NACK:
+        finish(TwiRequest::NACK);
+        break;
+      default: // Arbitration lost or bus error
+        finish(TwiRequest::ERROR);
+        break;
+    }
+  }
+
+private:
+  void start() {
+    reading = head->txLength == 0;
+    startedMs = millis();
+    TWCR = CONTROL | _BV(TWSTA);
+  }
+
+  // Up to nine SCL pulses let a slave finish the byte it is sending and
+  // release SDA; SDA rising while SCL is high is then a STOP
+  void recover() {
+    TWCR = 0; // Hands the pins back to the port registers
+    Sda::input(); Sda::high();
+    for (uint8_t i = 0; i < 9 && !Sda::read(); ++i) {
+      Scl::low(); Scl::output();
+      delayMicroseconds(5);
+      Scl::input(); Scl::high();
+      delayMicroseconds(5);
+    }
+    Sda::low(); Sda::output();
+    delayMicroseconds(5);
+    Sda::input(); Sda::high();
+    delayMicroseconds(5);
+    TWCR = _BV(TWEN);
+  }
+
+  void finish(TwiRequest::Status status) {
+    TwiRequest *r = head;
+    if (status != TwiRequest::OK) errors++;
+    head = r->next;
+    r->status = status;
+    if (r->done) r->done(r);
+    if (head) {
+      reading = head->txLength == 0;
+      startedMs = millis();
+      TWCR = CONTROL | _BV(TWSTO) | _BV(TWSTA); // STOP, then START the next request
+    } else {
+      tail = nullptr;
+      TWCR = _BV(TWEN) | _BV(TWINT) | _BV(TWSTO);
+    }
+  }
+};
@@ -1,44 +1,157 @@
 #include <Arduino.h>
-#include "HX711.h"
-#include <Wire.h>
-#include <LiquidCrystal_I2C.h>
+#include "measurement_history.h"
+#include "session_log.h"
+#include "console.h"
+#include "profiler.h"
+#include "calibration.h"
+#include "mount_height.h"
+#include "fast_pin.h"
+#include "hx711_fast.h"
+#include "sway.h"
+#include "ranger.h"
+#include "twi.h"
+#include "pcf8574_lcd.h"
+#include "text_format.h"
+#include "trace.h"
+#include "tuning.h"
+#include "stability.h"
+#include "glitch_filter.h"
+#include "sensor_health.h"
+#include "streaming_zero.h"
+#include "deadline.h"
+#include "sram.h"
 
 // --- Pin Definitions ---
 const int PIN_SCALE_DOUT = 3;
 const int PIN_SCALE_CLK = 2;
+const int PIN_SCALE_DOUT_2 = 5; // Further corners of four-cell platforms, same port as PIN_SCALE_DOUT
+const int PIN_SCALE_DOUT_3 = 6;
+const int PIN_SCALE_DOUT_4 = 7;
+const int PIN_SCALE_RATE = 4; // HX711 RATE pin: LOW = 10 SPS, HIGH = 80 SPS
 const int PIN_US_TRIG = 10;
 const int PIN_US_ECHO = 9;
+const int PIN_FLASH_CS = 8; // Optional SPI flash for the session log
 
 // --- Constants ---
-const float SENSOR_MOUNT_HEIGHT_CM = 250.0; // Ultrasonic sensor height from floor
+const float SENSOR_MOUNT_HEIGHT_CM = 250.0; // Ultrasonic sensor height from floor until one is learned
+const float EMPTY_PLATFORM_KG = 2.0; // Below this the floor is visible to the ranger
 const float SCALE_CALIBRATION_FACTOR = -21300.0;
 const int LCD_COLS = 16;
 const int LCD_ROWS = 2;
 const int LCD_I2C_ADDR = 0x27;
-const int SCALE_SAMPLES = 5; // Average over 5 readings
-const unsigned long LOOP_DELAY_MS = 500;
-const float SOUND_TIME_US_PER_CM = 29.15452;
-const unsigned long US_TIMEOUT_US = 30000; // 30ms timeout for ultrasonic pulse
+const byte SCALE_GAIN = 128; // Channel A gain 128 or 64, 32 selects channel B
+const int SCALE_SPS_SLOW = 10;
+const int SCALE_SPS_FAST = 80;
+const int SCALE_RATE_SETTLE_CONVERSIONS = 4; // Digital filter settling after a RATE change
+const float ZERO_SPREAD_KG = 0.2; // Largest spread of the conversions a streaming zero averages
+const float ZERO_SAVE_KG = 0.1; // A boot zero this far from the stored one is saved
+const float GLITCH_SLEW_KG = 40.0; // Larger jumps between conversions need a second conversion to confirm
+const float GLITCH_NOISE_KG = 0.02; // Bit-slip match tolerance, ~10x the 80 SPS conversion noise
+const unsigned long ACQUIRE_TIMEOUT_MS = 250; // Longest a loop pass waits for sensors beyond the sample window
+const unsigned long SERIAL_BAUD = 9600;
+const unsigned long EXPORT_BAUD = 500000; // Exact at 16 MHz
+const unsigned long CAL_RESULT_MS = 2000; // How long the calibration outcome stays on the LCD
+
+// --- Deadlines ---
+// Soft budgets per task in DeadlineMonitor::Task order: loop pass (without
+// its pause), acquire, display, console command, log flush. A stretch of
+// 2 s without a watchdog kick records a crash and resets the board.
+const uint16_t TASK_BUDGET_MS[DeadlineMonitor::TASKS] = { 1500, 1000, 50, 2000, 200 };
 
 // --- Stability Check Constants ---
-const float WEIGHT_TOLERANCE_KG = 2.0; // Maximum weight difference for stability
-const float HEIGHT_TOLERANCE_CM = 3.0; // Maximum height difference for stability
-const int STABLE_READINGS_REQUIRED = 5; // Number of consecutive stable readings needed
+// Tolerances and the stable count are in tuning.h
+const int SWAY_LIMIT_MM_S = 40; // Centre-of-pressure speed that counts as movement (four-cell platforms)
+const int SWAY_STILL_MM_S = 8; // Below this half the stable readings are enough
+
+// Once the idle noise is measured the tolerances follow it, capped by the
+// settings above. The stable count becomes the readings whose mean lies
+// within the set tolerance at NOISE_SIGMAS standard errors, capped by the
+// stable_count setting and at least STABLE_READINGS_MIN.
+const uint8_t NOISE_SIGMAS = 3; // Pair differences within this many noise sds count as still
+const float WEIGHT_LOAD_TOLERANCE = 0.01; // Plus this fraction of the load for breathing and sway
+const float WEIGHT_MIN_TOLERANCE_KG = 0.1;
+const float HEIGHT_MIN_TOLERANCE_CM = 0.5;
+const uint8_t STABLE_READINGS_MIN = 2; // One still pair is no evidence of settling
+
+// --- Result Latching ---
+const float RESULT_WEIGHT_STEP_KG = 1.0; // Shown weight follows only moves of at least this much
+const float RESULT_HEIGHT_STEP_CM = 1.0;
+const float BMI_HYSTERESIS = 0.3; // Band around each category threshold
+
+// --- Runtime Settings ---
+// Start from the constants above and can be changed live from the serial console
+struct Settings {
+  float weightToleranceKg = WEIGHT_TOLERANCE_KG;
+  float heightToleranceCm = HEIGHT_TOLERANCE_CM;
+  int stableReadingsRequired = STABLE_READINGS_REQUIRED;
+  int swayLimitMmS = SWAY_LIMIT_MM_S;
+  unsigned long loopDelayMs = LOOP_DELAY_MS;
+  int scaleSamples = SCALE_SAMPLES;
+  float mountHeightCm = SENSOR_MOUNT_HEIGHT_CM;
+  float scaleFactor = SCALE_CALIBRATION_FACTOR;
+  int pipeline = 1; // 0 = ping, then weigh (for comparing throughput)
+
+  void sanitize(); // Clamps every field to its console range
+} settings;
+
+// --- Load Cells ---
+// Four-corner platforms: MultiHX711<PIN_SCALE_CLK, PIN_SCALE_DOUT, PIN_SCALE_DOUT_2, PIN_SCALE_DOUT_3, PIN_SCALE_DOUT_4>
+typedef HX711Fast<PIN_SCALE_DOUT, PIN_SCALE_CLK> ScaleSensor;
+
+struct ChannelTrims {
+  float trim[ScaleSensor::CHANNELS];
+};
+typedef Persistent<ChannelTrims, EEPROM_CHANNEL_TRIMS, 0x7214> StoredTrims;
+
+// Zero of the last tare at SCALE_GAIN, so boot can weigh before a new one
+struct ScaleZero {
+  long offset;
+  long channelOffset[ScaleSensor::CHANNELS];
+};
+typedef Persistent<ScaleZero, EEPROM_SCALE_ZERO, 0x2E50> StoredZero;
+
+#ifdef __AVR__ // The host pads the records and has 64-bit longs
+static_assert(EEPROM_CALIBRATION + sizeof(StoredCalibration) <= EEPROM_MOUNT_HEIGHT, "StoredCalibration overlaps");
+static_assert(EEPROM_MOUNT_HEIGHT + sizeof(StoredMountHeight) <= EEPROM_CHANNEL_TRIMS, "StoredMountHeight overlaps");
+static_assert(EEPROM_CHANNEL_TRIMS + sizeof(StoredTrims) <= EEPROM_SCALE_ZERO, "StoredTrims overlaps");
+static_assert(EEPROM_SCALE_ZERO + sizeof(StoredZero) <= EEPROM_CRASH_RECORD, "StoredZero overlaps");
+static_assert(EEPROM_CRASH_RECORD + sizeof(StoredCrash) <= EEPROM_LOG_START, "StoredCrash overlaps");
+#endif
 
-// --- Scratch memory ---
-char buffer[50];
+// --- Height Ranger ---
+// Time-of-flight alternative sharing the LCD's I2C bus: Vl53l1xRanger
+typedef UltrasonicRanger<PIN_US_TRIG, PIN_US_ECHO> RangerSensor;
+
+// --- Trace Replay ---
+// Built with -DTRACE_REPLAY the pipeline takes its readings from a trace
+// captured with the "trace" command, sent to the serial port at EXPORT_BAUD
+// (tools/trace.py send), or read from a file by the native build (host/)
+#ifdef TRACE_REPLAY
+typedef ReplayScale<ScaleSensor> Scale;
+typedef ReplayRanger<RangerSensor, Scale> Ranger;
+#else
+typedef ScaleSensor Scale;
+typedef RangerSensor Ranger;
+#endif
+
+// --- Sample History ---
+const uint8_t HISTORY_SIZE = 32; // Power of two, 6 bytes per sample
+typedef MeasurementHistory<HISTORY_SIZE> History;
+
+// --- Session Log ---
+// Swap in SpiFlashLogStore<PIN_FLASH_CS> when the board carries a flash chip
+typedef SessionLog<EepromLogStore> Log;
 
 // BMI display class
-struct BMI_Display : LiquidCrystal_I2C {
-  BMI_Display()
-    : LiquidCrystal_I2C(LCD_I2C_ADDR, LCD_COLS, LCD_ROWS) {
+struct BMI_Display : Pcf8574Lcd<LCD_COLS, LCD_ROWS> {
+  BMI_Display() {
     memcpy(row1, emptyline, LCD_COLS);
     memcpy(row2, emptyline, LCD_COLS);
-    row1[LCD_COLS] = row2[LCD_COLS] = 0; // zerobyte at the end of the strings so lcd.print() works correctly
+    row1[LCD_COLS] = row2[LCD_COLS] = 0; // zerobyte at the end of the strings so Serial.print() works correctly
   }
 
   char row1[LCD_COLS+1], row2[LCD_COLS+1];
-  const char* emptyline = "               ";
+  const char* emptyline = "                ";
   char
     *lcd_weight = row1,
     *lcd_height = row2,
@@ -62,45 +175,59 @@ struct BMI_Display : LiquidCrystal_I2C {
   };
 
   int weight = 0, height = 0;
+  int category = -1; // index into bmi_words, -1 before the first result
+  bool showingResults = false; // rows hold results rather than a message
 
-  void init() {
-    LiquidCrystal_I2C::init();
-    backlight();
-    clear();
+  void init(Twi &twi) {
+    begin(twi, LCD_I2C_ADDR);
   }
 
+  // Queues the rows on the TWI bus and returns immediately
   void update() {
-    this->setCursor(0, 0);
-    this->print(row1);
-    this->setCursor(0, 1);
-    this->print(row2);
+    const char *rows[LCD_ROWS] = { row1, row2 };
+    show(rows);
   }
 
   void setWeight(int weight) {
     this->weight = weight;
-    printValue(lcd_weight, 8, "%d kg", weight);
+    formatDecimal(lcd_weight, 4, weight);
+    memcpy(lcd_weight + 4, " kg ", 4);
   }
 
   void setHeight(int height) {
     this->height = height;
-    printValue(lcd_height, 7, "%d cm", height);
+    formatDecimal(lcd_height, 3, height);
+    memcpy(lcd_height + 3, " cm ", 4);
+  }
+
+  // Placeholders while a channel is still settling
+  void clearWeight() { memcpy(lcd_weight, "  -- kg ", 8); }
+  void clearHeight() { memcpy(lcd_height, "--- cm ", 7); }
+  void clearBMI() {
+    memcpy(lcd_bmi_value - 4, "BMI=--.-", 8);
+    memcpy(lcd_bmi_word, emptyline, 7);
   }
 
   void updateBMI() {
     float bmi = 10000.0 * weight / height / height;
     memcpy(lcd_bmi_value - 4, "BMI=", 4);
-    printValue(lcd_bmi_value, 4, bmi);
+    formatDecimal(lcd_bmi_value, 4, (int)(bmi * 10 + 0.5), 1);
     int i = getHeightIndex();
     int index = 0;
-    if(bmi > bmi_values[i][0]) index = 1;
-    if(bmi > bmi_values[i][1]) index = 2;
-    if(bmi > bmi_values[i][2]) index = 3;
+    for (int t = 0; t < 3; ++t) {
+      // Leaving the current category takes BMI_HYSTERESIS beyond its threshold
+      float threshold = bmi_values[i][t];
+      if (category >= 0) threshold += t < category ? -BMI_HYSTERESIS : BMI_HYSTERESIS;
+      if (bmi > threshold) index = t + 1;
+    }
     memcpy(lcd_bmi_word, bmi_words[index], 7);
+    category = index;
   }
 
   void message(const char* line1, const char* line2 = "") {
     int len1 = strlen(line1), len2 = strlen(line2);
     if (len1 > LCD_COLS || len2 > LCD_COLS) return;
+    showingResults = false;
     // Clear entire display buffer first
     memset(row1, ' ', LCD_COLS);
     memset(row2, ' ', LCD_COLS);
@@ -111,17 +238,6 @@ struct BMI_Display : LiquidCrystal_I2C {
   }
 
 private:
-  void printValue(char* position, int size, const char* format, int value) {
-    int chars = snprintf(position, size, format, value);
-    if (size > chars) memcpy(position + chars, emptyline, size - chars); // right pad spaces, avoid zerobytes
-  }
-  void printValue(char* position, int size, float value) {
-    dtostrf(value, 2, 1, buffer); // Arduino does not support snprintf with %f
-    memcpy(position, buffer, size);
-    int chars = strlen(position);
-    if (size > chars) memcpy(position + chars, emptyline, size - chars);
-  }
-
   int getHeightIndex() {
     const int height_groups[5] = { 115, 130, 145, 155, 165 }; // cm
     for(int i=0; i<5; ++i) if (height < height_groups[i]) return i;
@@ -130,141 +246,934 @@ private:
 };
 
 // --- Stability Tracking ---
+// Weight and height lock independently, so each can be shown as soon as it
+// settles. The policy (stability.h, chosen in tuning.h) decides what
+// settled means for a channel.
+#define POLICY_TEXT(policy) #policy
+#define POLICY_NAME(policy) POLICY_TEXT(policy)
+
+template<typename Policy>
 struct StabilityTracker {
-  float lastWeight = 0;
-  float lastHeight = 0;
-  int stableCount = 0;
+  Policy weight, height;
+  NoiseFloor weightNoise, heightNoise; // kept across sessions
+  float lastIdleDistanceCm = -1;
+  uint8_t weightWindow = 1, heightWindow = 1; // newest samples that settled
   bool wasStable = false;
 
-  bool checkStability(float currentWeight, float currentHeight, bool &movementDetected) {
-    movementDetected = false;
-    
-    bool stable = (fabs(currentWeight - lastWeight) <= WEIGHT_TOLERANCE_KG) &&
-                  (fabs(currentHeight - lastHeight) <= HEIGHT_TOLERANCE_CM);
-    
-    if (stable) {
-      stableCount++;
-    } else {
-      stableCount = 0;
-      movementDetected = true;
+  // Feeds the newest sample to both channels; on four-cell platforms the
+  // centre-of-pressure speed also counts. Returns true when either channel moved.
+  bool update(const History &history, const SwayEstimator &sway) {
+    bool swaying = sway.moving(settings.swayLimitMmS);
+    uint8_t required = settings.stableReadingsRequired;
+    if (sway.still(SWAY_STILL_MM_S)) required = (required + 1) / 2;
+
+    int16_t load = history.size() ? history.at(0).weight : 0;
+    uint8_t weightRequired = readingsRequired(weightNoise, settings.weightToleranceKg * 100, required);
+    uint8_t heightRequired = readingsRequired(heightNoise, settings.heightToleranceCm * 10, required);
+    bool weightStill = weight.update(history, History::WEIGHT, weightTolerance(load), weightRequired, swaying);
+    bool heightStill = height.update(history, History::HEIGHT, heightTolerance(), heightRequired, swaying);
+    // Every policy settles on at least the newest required + 1 samples
+    weightWindow = min(weightRequired + 1, History::capacity());
+    heightWindow = min(heightRequired + 1, History::capacity());
+    return !weightStill || !heightStill;
+  }
+
+  // Filtered values for the result: the median of the settled samples, so
+  // one outlying pass does not move the shown result
+  float weightKg(const History &history) const { return history.median(History::WEIGHT, weightWindow) / 100.0; }
+  float heightCm(const History &history) const { return history.median(History::HEIGHT, heightWindow) / 10.0; }
+
+  // The set count until the noise is known, then as many as the mean needs
+  static uint8_t readingsRequired(const NoiseFloor &noise, int16_t tolerance, uint8_t limit) {
+    if (!noise.known()) return limit;
+    uint8_t n = noise.samplesWithin(tolerance, NOISE_SIGMAS);
+    if (n < STABLE_READINGS_MIN) n = STABLE_READINGS_MIN;
+    return min(n, limit);
+  }
+
+  // Learns the noise floors from an empty platform: the weight from the
+  // history, the height from the ranger's view of the floor
+  void idle(const History &history, float distanceCm, bool obstructed) {
+    int16_t empty = EMPTY_PLATFORM_KG * 100;
+    int16_t a = history.size() ? history.at(0).weight : -1;
+    if (history.size() < 2 || a < 0 || a >= empty) {
+      lastIdleDistanceCm = -1; // Someone may be in the ranger's view
+      return;
     }
+    int16_t b = history.at(1).weight;
+    if (b >= 0 && b < empty) weightNoise.add(a - b);
+    if (obstructed) distanceCm = -1;
+    if (distanceCm >= 0 && lastIdleDistanceCm >= 0) heightNoise.add((int16_t)((distanceCm - lastIdleDistanceCm) * 10));
+    lastIdleDistanceCm = distanceCm;
+  }
 
-    lastWeight = currentWeight;
-    lastHeight = currentHeight;
+  // Pair tolerances in history units (dag, mm), settings until the noise is known
+  int16_t weightTolerance(int16_t loadDag) const {
+    int16_t limit = settings.weightToleranceKg * 100;
+    if (!weightNoise.known()) return limit;
+    int16_t tolerance = weightNoise.tolerance(NOISE_SIGMAS) + max(loadDag, 0) * WEIGHT_LOAD_TOLERANCE;
+    return constrain(tolerance, min((int16_t)(WEIGHT_MIN_TOLERANCE_KG * 100), limit), limit);
+  }
 
-    return stableCount >= STABLE_READINGS_REQUIRED;
+  int16_t heightTolerance() const {
+    int16_t limit = settings.heightToleranceCm * 10;
+    if (!heightNoise.known()) return limit;
+    return constrain(heightNoise.tolerance(NOISE_SIGMAS), min((int16_t)(HEIGHT_MIN_TOLERANCE_CM * 10), limit), limit);
   }
 
+  bool weightStable() const { return weight.stable; }
+  bool heightStable() const { return height.stable; }
+
   void reset() {
-    stableCount = 0;
-    lastWeight = 0;
-    lastHeight = 0;
+    weight.reset();
+    height.reset();
     wasStable = false;
   }
+
+  void printNoise(Print &out) const {
+    out.println(F("policy: " POLICY_NAME(STABILITY_POLICY)));
+    out.print(F("tolerance: weight "));
+    out.print(weightTolerance(0) / 100.0);
+    out.print(weightNoise.known() ? F(" kg + load, height ") : F(" kg (fixed), height "));
+    out.print(heightTolerance() / 10.0);
+    out.println(heightNoise.known() ? F(" cm") : F(" cm (fixed)"));
+  }
+};
+
+typedef StabilityTracker<STABILITY_POLICY> Stability; // tuning.h
+
+// --- Result Latching ---
+// Holds the shown weight and height until the filtered value moves by a
+// whole display step, so noise near a rounding edge does not reformat and
+// resend the result every pass
+struct ResultLatch {
+  float weight = -1, height = -1; // -1 = nothing latched yet
+
+  bool latchWeight(float value) { return latch(weight, value, RESULT_WEIGHT_STEP_KG); }
+  bool latchHeight(float value) { return latch(height, value, RESULT_HEIGHT_STEP_CM); }
+
+  void reset() { weight = height = -1; }
+
+private:
+  static bool latch(float &held, float value, float step) {
+    if (held >= 0 && fabs(value - held) < step) return false;
+    held = value;
+    return true;
+  }
 };
 
 // --- Hardware Objects ---
-HX711 scale;
+Twi twi;
+Scale scale;
+Ranger ranger;
+SwayEstimator sway;
+bool swayPending = false; // A conversion arrived since the last sway update
+bool scaleFast = false;
+int scaleDiscard = 0; // Conversions to drop until the HX711 filter has settled
 BMI_Display lcd;
-StabilityTracker stability;
+Stability stability;
+ResultLatch result;
+uint8_t shownChannels = 0; // bit 0 weight, bit 1 height, bit 2 ranger fault on the result screen
+History history;
+Log sessionLog;
+Console<> console;
+Calibrator calibrator;
+MountHeightLearner mountLearner;
+GlitchFilter<Scale::CHANNELS> glitches;
+SensorHealth health;
+StreamingZero<Scale::CHANNELS> zeroing;
+bool zeroKnown = false; // stored or measured zero in use
+TraceWriter<Scale> trace;
+TraceMonitor<TraceWriter<Scale> > monitor(trace, Serial); // All text for the serial monitor
+#ifdef TRACE_REPLAY
+TraceReader<Scale> replay;
+#endif
+byte scaleGain = SCALE_GAIN;
+
+// Tolerances must stay positive and within the int16 history units (dag, mm)
+ConsoleParam params[] = {
+  { "weight_tol", ConsoleParam::FLOAT, &settings.weightToleranceKg, 0.05, 100 },
+  { "height_tol", ConsoleParam::FLOAT, &settings.heightToleranceCm, 0.1, 100 },
+  { "stable_count", ConsoleParam::INT, &settings.stableReadingsRequired, 1, 100 },
+  { "sway_limit", ConsoleParam::INT, &settings.swayLimitMmS, 1, 1000 },
+  { "loop_delay", ConsoleParam::ULONG, &settings.loopDelayMs, 0, 10000 },
+  { "samples", ConsoleParam::INT, &settings.scaleSamples, 1, 60 }, // Fast window must fit get_units()' byte
+  { "mount_height", ConsoleParam::FLOAT, &settings.mountHeightCm, 100, 400 },
+  { "scale_factor", ConsoleParam::FLOAT, &settings.scaleFactor, -1e7, 1e7 },
+  { "pipeline", ConsoleParam::INT, &settings.pipeline, 0, 1 },
+};
+const int PARAM_COUNT = sizeof(params) / sizeof(params[0]);
+
+void Settings::sanitize() {
+  for (ConsoleParam &param : params) param.clamp();
+  if (scaleFactor == 0) scaleFactor = SCALE_CALIBRATION_FACTOR;
+}
+
+// --- Profiling ---
+StageTimer timeAcquire("acquire"), timeDisplay("display"), timeLoop("loop");
+StageTimer timeResult("result"); // From stepping on to the first complete result
+DeadlineMonitor deadlines;
+volatile WatchdogSnapshot watchdogSnapshot __attribute__((section(".noinit"))); // Survives the watchdog reset
+bool stackWarned = false;
+bool occupied = false;
+unsigned long occupiedMs = 0;
+unsigned long heightSamples = 0, weightSamples = 0, profileStartMs = 0;
 
 // --- Function Prototypes ---
-float measureHeightCm();
-float measureWeightKg();
+void acquire(float &distanceCm, float &weightKg);
+float heightFromDistance(float distanceCm);
+void learnMountHeight(float distanceCm, float weightKg);
+void updateSway();
+bool sampleWeight(long &sum, int &count);
+void handleSerial();
+bool applySetting(ConsoleParam &param, const char *value);
+bool applySetting(const char *name, const char *value);
+void updateDisplay();
+void endPass(unsigned long pauseMs);
+void pause(unsigned long ms);
+void printMemory();
+void exportLog();
+void runCalibration();
+void showCalibrationStep();
+void setScaleRate(bool fast);
+void setScaleGain(byte gain);
+long readScale();
+long glitchSlew();
+long glitchNoise();
+void traceState();
+void printResult(bool complete);
+void reportHealth(SensorHealth::Event event);
+void updateZero(long value, float weightKg);
+void saveZero();
+int scaleSamples();
+unsigned long loopDelayMs();
+
+#ifdef __AVR__
+// A watchdog reset leaves the watchdog running at its shortest timeout, so it
+// is stopped before the C runtime and Arduino init() get a chance to hang
+void stopWatchdogEarly() __attribute__((naked, used, section(".init3")));
+void stopWatchdogEarly() {
+  MCUSR = 0;
+  wdt_disable();
+}
+
+// Paints free SRAM for the stack high-water mark. Runs before the stack
+// pointer and r1 are set up, so it may only touch registers.
+void paintStack() __attribute__((naked, used, section(".init1")));
+void paintStack() {
+  __asm__ __volatile__(
+    "    ldi r30, lo8(_end)\n"
+    "    ldi r31, hi8(_end)\n"
+    "    ldi r24, %0\n"
+    "    ldi r25, hi8(__stack)\n"
+    "    rjmp 2f\n"
+    "1:  st Z+, r24\n"
+    "2:  cpi r30, lo8(__stack)\n"
+    "    cpc r31, r25\n"
+    "    brlo 1b\n"
+    "    breq 1b\n"
+    :: "M" (STACK_CANARY));
+}
+#endif
+
+ISR(WDT_vect) {
+  deadlines.onWatchdog();
+}
+
+ISR(TWI_vect) {
+  twi.isr();
+}
+
+ISR(PCINT0_vect) { // PIN_US_ECHO is on PORTB
+  ranger.onEchoEdge();
+}
+
+#ifdef PROFILE_CYCLES
+ISR(TIMER1_OVF_vect) {
+  profileOverflows()++;
+}
+#endif
 
 void setup() {
-  Serial.begin(9600);
+#ifdef TRACE_REPLAY
+  Serial.begin(EXPORT_BAUD);
+  replay.begin(Serial, scale, settings.mountHeightCm);
+  scale.attach(replay);
+  ranger.attach(replay);
+#else
+  Serial.begin(SERIAL_BAUD);
+#endif
+  profileBegin();
 
-  pinMode(PIN_US_TRIG, OUTPUT);
-  pinMode(PIN_US_ECHO, INPUT);
+  // The HX711 starts first at 80 SPS, so its first conversions settle while
+  // the LCD initialises; the zero comes from EEPROM or streaming conversions
+  pinMode(PIN_SCALE_RATE, OUTPUT);
+  setScaleRate(true); // Idle and settling run at 80 SPS
+
+  StoredCalibration stored;
+  if (stored.load()) settings.scaleFactor = stored.value.factor;
+  StoredTrims trims;
+  if (trims.load()) memcpy(scale.trim, trims.value.trim, sizeof(scale.trim));
+
+  scale.begin(SCALE_GAIN);
+  scale.set_scale(settings.scaleFactor);
+  StoredZero zero;
+  if (zero.load()) {
+    scale.offset = zero.value.offset;
+    memcpy(scale.channelOffset, zero.value.channelOffset, sizeof(scale.channelOffset));
+    zeroKnown = true;
+  }
+#ifdef TRACE_REPLAY
+  zeroing.done = zeroKnown = true; // The trace's STATE records carry the zero
+#endif
+
+  twi.begin();
+  lcd.init(twi);
+  ranger.begin(twi);
+  if (zeroKnown) lcd.message("Stoupni si", "na vahu");
+  else lcd.message("Nulovani", "nestoupej");
+  lcd.update();
 
-  lcd.init();
+  sessionLog.begin();
+  mountLearner.begin(settings.mountHeightCm);
 
-  scale.begin(PIN_SCALE_DOUT, PIN_SCALE_CLK);
-  scale.set_scale(SCALE_CALIBRATION_FACTOR);
-  delay(200); // Allow scale to stabilize
-  scale.tare(); // Reset scale to 0
+  deadlines.begin(TASK_BUDGET_MS, watchdogSnapshot);
+  if (deadlines.watchdogReset) {
+    monitor.print(F("Reset by watchdog in "));
+    monitor.println(DeadlineMonitor::name(deadlines.crash.value.task));
+  }
 }
 
 void loop() {
-  float currentHeight = measureHeightCm();
-  float currentWeight = measureWeightKg();
-
-  Serial.print("Height: ");
-  Serial.print(currentHeight);
-  Serial.print(" cm, Weight: ");
-  Serial.print(currentWeight);
-  Serial.println(" kg");
-
-  // Check if person is on the scale
-  if (currentWeight < 10 || currentHeight < 100) {
-    lcd.message("Stoupni si", "na vahu");
-    lcd.update();
+  deadlines.kick();
+  twi.poll(); // Frees a stuck bus so the display and ToF ranger carry on
+  if (lcd.damaged) updateDisplay(); // A frame failed: repaint now, not on the next change
+  deadlines.start(DeadlineMonitor::CONSOLE);
+  handleSerial();
+  deadlines.finish(DeadlineMonitor::CONSOLE);
+
+  if (calibrator.active()) {
+    runCalibration();
+    return;
+  }
+
+  timeLoop.start();
+  deadlines.start(DeadlineMonitor::LOOP);
+  timeAcquire.start();
+  deadlines.start(DeadlineMonitor::ACQUIRE);
+  float currentDistance, currentWeight;
+  acquire(currentDistance, currentWeight);
+  float currentHeight = heightFromDistance(currentDistance);
+  updateSway();
+  deadlines.finish(DeadlineMonitor::ACQUIRE);
+  timeAcquire.stop();
+  learnMountHeight(currentDistance, currentWeight);
+  history.push(millis(), currentWeight, currentHeight);
+
+  monitor.print("Height: ");
+  monitor.print(currentHeight);
+  monitor.print(" cm, Weight: ");
+  monitor.print(currentWeight);
+  monitor.println(" kg");
+
+  if (!zeroKnown) {
+    // No stored zero: nobody may step on before the streaming zero is found
+    lcd.message("Nulovani", "nestoupej");
+    updateDisplay();
+    endPass(0);
+    return;
+  }
+
+  // Check if person is on the scale; without a working ranger the weight decides
+  if (health.scaleFault || currentWeight < 10 || (!health.rangerFault && currentHeight < 100)) {
+    if (health.scaleFault) lcd.message("Porucha vahy", "zkontroluj kabel");
+    else if (mountLearner.obstructed) lcd.message("Senzor vysky", "je zakryty");
+    else lcd.message("Stoupni si", "na vahu");
+    updateDisplay();
+    stability.idle(history, currentDistance, mountLearner.obstructed);
+    if (occupied && !stability.wasStable) printResult(false);
+    occupied = false;
     stability.reset();
-    delay(LOOP_DELAY_MS);
+    result.reset();
+    lcd.category = -1;
+    setScaleRate(true);
+    if (sessionLog.batchFull()) {
+      // Write while nobody is waiting
+      deadlines.start(DeadlineMonitor::LOG);
+      sessionLog.flush();
+      deadlines.finish(DeadlineMonitor::LOG);
+    }
+    endPass(loopDelayMs());
     return;
   }
 
+  if (!occupied) {
+    occupied = true;
+    occupiedMs = millis();
+    timeResult.start();
+  }
+
   // Check if measurements are stable
-  bool movementDetected = false;
-  bool isStable = stability.checkStability(currentWeight, currentHeight, movementDetected);
-  
-  if (movementDetected) {
-    // Movement detected - ask user to stay still
-    lcd.message("Stuj klidne", "a rovne");
-    lcd.update();
-    delay(LOOP_DELAY_MS);
+  bool movementDetected = stability.update(history, sway);
+  bool weightStable = stability.weightStable();
+  bool heightStable = stability.heightStable() && !health.rangerFault;
+  bool held = stability.wasStable; // A confirmed result stays up until stepping off
+
+  if (!weightStable && !heightStable && !held) {
+    if (movementDetected) {
+      // Movement detected - ask user to stay still
+      lcd.message("Stuj klidne", "a rovne");
+      setScaleRate(true);
+    } else {
+      // Checking for value stabilization is in progress
+      lcd.message("Probiha", "mereni...");
+    }
+    updateDisplay();
+    endPass(loopDelayMs());
     return;
   }
-  
-  if (!isStable) {
-    // Checking for value stabilization is in progress
-    lcd.message("Probiha", "mereni...");
-    lcd.update();
-    delay(LOOP_DELAY_MS);
-    return;
+
+  if (!weightStable) {
+    setScaleRate(true);
+  } else if (scaleFast) {
+    // Settled at 80 SPS - take the final reading at the quieter 10 SPS rate
+    setScaleRate(false);
+    float preciseDistance, preciseWeight;
+    acquire(preciseDistance, preciseWeight);
+    if (preciseWeight >= 0) history.push(millis(), preciseWeight, currentHeight); // Joins the settled window
   }
 
-  // Measurements are valid and stable - display results
-  // Clear both rows first to avoid leftover characters from previous messages
-  memcpy(lcd.row1, lcd.emptyline, LCD_COLS);
-  memcpy(lcd.row2, lcd.emptyline, LCD_COLS);
+  // Show each channel as soon as it is stable, BMI once both are. A
+  // confirmed result keeps its rows while the person moves; a settled
+  // channel still updates them. Rows are only reformatted when a latched
+  // value or the set of shown channels changes, otherwise the display
+  // already shows the result.
+  bool changed = weightStable && result.latchWeight(stability.weightKg(history));
+  changed |= heightStable && result.latchHeight(stability.heightCm(history));
+  bool showWeight = weightStable || held, showHeight = heightStable || held;
+  uint8_t channels = (showWeight ? 1 : 0) | (showHeight ? 2 : 0) | (health.rangerFault ? 4 : 0);
+  if (changed || channels != shownChannels || !lcd.showingResults) {
+    shownChannels = channels;
+    // Clear both rows first to avoid leftover characters from previous messages
+    memcpy(lcd.row1, lcd.emptyline, LCD_COLS);
+    memcpy(lcd.row2, lcd.emptyline, LCD_COLS);
 
-  lcd.setWeight((int)currentWeight);
-  lcd.setHeight((int)currentHeight);
-  lcd.updateBMI();
+    if (showWeight) lcd.setWeight((int)result.weight);
+    else lcd.clearWeight();
+    if (showHeight) lcd.setHeight((int)result.height);
+    else lcd.clearHeight();
+    if (showWeight && showHeight) lcd.updateBMI();
+    else lcd.clearBMI();
+    if (health.rangerFault) memcpy(lcd.lcd_bmi_word, "porucha", 7); // Weight only
+    lcd.showingResults = true;
+    updateDisplay(); // Only the changed characters go out
+  }
+
+  if (weightStable && heightStable && !stability.wasStable) {
+    // First result of this session
+    stability.wasStable = true;
+    timeResult.stop();
+    printResult(true);
+    sessionLog.append(result.weight, result.height, lcd.category);
+  }
+
+  endPass(loopDelayMs());
+}
+
+void updateDisplay() {
+  timeDisplay.start();
+  deadlines.start(DeadlineMonitor::DISPLAY);
   lcd.update();
+  deadlines.finish(DeadlineMonitor::DISPLAY);
+  timeDisplay.stop();
+}
+
+void endPass(unsigned long pauseMs) {
+  deadlines.finish(DeadlineMonitor::LOOP);
+  if (!stackWarned && stackNearLimit()) {
+    stackWarned = true;
+    monitor.println(F("SRAM: stack close to static data, see mem"));
+  }
+  timeLoop.stop();
+  pause(pauseMs);
+}
+
+// delay() that keeps the watchdog fed, for pauses longer than its timeout
+void pause(unsigned long ms) {
+  while (ms > 0) {
+    unsigned long step = ms < 500 ? ms : 500;
+    delay(step);
+    deadlines.kick();
+    ms -= step;
+  }
+}
+
+void handleSerial() {
+#ifdef TRACE_REPLAY
+  return; // The serial input is the trace
+#endif
+  if (!console.poll(Serial)) return;
+  const char *cmd = console.next();
+  if (!cmd) return; // Blank line
+
+  if (!strcmp(cmd, "get") || !strcmp(cmd, "set")) {
+    bool set = cmd[0] == 's';
+    const char *name = console.next();
+    const char *value = console.next();
+    for (int i = 0; i < PARAM_COUNT; ++i) {
+      if (name && strcmp(name, params[i].name)) continue;
+      if (set && !value) break;
+      if (set && !applySetting(params[i], value)) {
+        params[i].printRange(monitor);
+        return;
+      }
+      params[i].print(monitor);
+      if (name) return;
+    }
+    if (name || set) monitor.println(F("error: usage get [name] | set <name> <value>"));
+  } else if (!strcmp(cmd, "tare")) {
+    // The loop finds the new zero from its conversions, like at boot without
+    // a stored one; a blocking tare would hang on an unplugged HX711
+    zeroing.restart();
+    zeroing.done = zeroKnown = false;
+    monitor.println(F("tare: keep the platform still"));
+  } else if (!strcmp(cmd, "cal")) {
+    const char *arg = console.next();
+    if (arg && !strcmp(arg, "next")) {
+      calibrator.next();
+    } else if (arg && !strcmp(arg, "cancel")) {
+      calibrator.cancel();
+    } else if (arg && atof(arg) > 0) {
+      const char *check = console.next();
+      setScaleRate(false); // Calibrate at the precise rate
+      calibrator.start(atof(arg), check ? atof(check) : 0, scale.get_scale());
+    } else {
+      monitor.println(F("error: cal <reference kg> [check kg] | cal next | cal cancel"));
+      return;
+    }
+    showCalibrationStep();
+  } else if (!strcmp(cmd, "trim")) {
+    const char *channel = console.next();
+    const char *value = console.next();
+    if (channel && value) {
+      int c = atoi(channel);
+      if (c < 0 || c >= Scale::CHANNELS || atof(value) <= 0) {
+        monitor.println(F("error: trim <channel> <relative gain>"));
+        return;
+      }
+      scale.trim[c] = atof(value);
+      StoredTrims trims;
+      memcpy(trims.value.trim, scale.trim, sizeof(scale.trim));
+      trims.save();
+    }
+    for (int c = 0; c < Scale::CHANNELS; ++c) {
+      monitor.print(F("trim "));
+      monitor.print(c);
+      monitor.print(F(" = "));
+      monitor.print(scale.trim[c], 4);
+      monitor.print(F(", load "));
+      monitor.print(scale.channelUnits(c));
+      monitor.println(F(" kg"));
+    }
+  } else if (!strcmp(cmd, "gain")) {
+    const char *value = console.next();
+    int gain = value ? atoi(value) : 0;
+    if (gain == 128 || gain == 64 || gain == 32) setScaleGain(gain);
+    else monitor.println(F("error: gain 128|64|32"));
+    monitor.print(F("gain = "));
+    monitor.println(scaleGain);
+  } else if (!strcmp(cmd, "trace")) {
+    // Binary sensor trace at the export rate until the next "trace" line
+    if (trace.active()) {
+      monitor.endLine();
+      trace.end();
+      Serial.flush();
+      Serial.begin(SERIAL_BAUD);
+      monitor.println(F("trace off"));
+    } else {
+      monitor.print(F("Trace at "));
+      monitor.println(EXPORT_BAUD);
+      Serial.flush();
+      Serial.begin(EXPORT_BAUD);
+      trace.begin(Serial);
+      traceState();
+    }
+  } else if (!strcmp(cmd, "wd")) {
+    // Deadline misses and the crash record, "wd reset" clears both
+    const char *arg = console.next();
+    if (arg && !strcmp(arg, "reset")) {
+      deadlines.reset();
+      deadlines.clearRecord();
+    }
+    deadlines.print(monitor);
+  } else if (!strcmp(cmd, "mem")) {
+    printMemory();
+  } else if (!strcmp(cmd, "prof")) {
+    const char *arg = console.next();
+    bool reset = arg && !strcmp(arg, "reset");
+    StageTimer *timers[] = { &timeLoop, &timeAcquire, &timeDisplay, &timeResult };
+    for (StageTimer *t : timers) {
+      if (reset) t->reset();
+      else t->print(monitor);
+    }
+    if (reset) {
+      heightSamples = weightSamples = 0;
+      profileStartMs = millis();
+      return;
+    }
+    // Per-channel throughput, compare with "set pipeline 0"
+    float seconds = (millis() - profileStartMs) / 1000.0;
+    monitor.print(F("height: "));
+    monitor.print(heightSamples / seconds);
+    monitor.print(F("/s, weight: "));
+    monitor.print(weightSamples / seconds);
+    monitor.println(F("/s"));
+    stability.printNoise(monitor);
+    glitches.print(monitor);
+    health.print(monitor);
+    monitor.print(F("twi: errors "));
+    monitor.print(twi.errors);
+    monitor.print(F(", bus timeouts "));
+    monitor.println(twi.timeouts);
+  } else if (!strcmp(cmd, "log")) {
+    exportLog();
+  } else {
+    monitor.println(F("commands: get [name], set <name> <value>, tare, cal <kg> [kg], trim [c gain], gain <n>, prof [reset], log, trace, wd [reset], mem"));
+  }
+}
 
-  delay(LOOP_DELAY_MS);
+bool applySetting(ConsoleParam &param, const char *value) {
+  if (!param.parse(value)) return false;
+  settings.sanitize();
+  traceState();
+  if (param.value == &settings.scaleFactor) scale.set_scale(settings.scaleFactor / SCALE_GAIN * scaleGain);
+  return true;
 }
 
-float measureHeightCm() {
-  // Trigger ultrasonic sensor
-  digitalWrite(PIN_US_TRIG, LOW);
-  delayMicroseconds(2);
-  digitalWrite(PIN_US_TRIG, HIGH);
-  delayMicroseconds(10);
-  digitalWrite(PIN_US_TRIG, LOW);
+// By name, also for the native replay's --set
+bool applySetting(const char *name, const char *value) {
+  for (int i = 0; i < PARAM_COUNT; ++i) {
+    if (!strcmp(name, params[i].name)) return applySetting(params[i], value);
+  }
+  return false;
+}
 
-  long echoTime = pulseIn(PIN_US_ECHO, HIGH, US_TIMEOUT_US);
+void runCalibration() {
+  if (!scale.is_ready()) return;
+  if (scaleDiscard > 0) {
+    readScale();
+    scaleDiscard--;
+    return;
+  }
+  long value = readScale();
+  if (!glitches.accept(scale.raw, glitchSlew(), glitchNoise())) return;
+  if (calibrator.feed(value)) showCalibrationStep();
+}
 
-  if (echoTime == 0) {
-    return -1; // No echo received (out of range)
+void showCalibrationStep() {
+  switch (calibrator.state) {
+    case Calibrator::ZERO:
+      lcd.message("Kalibrace", "uvolni vahu");
+      break;
+    case Calibrator::REFERENCE:
+    case Calibrator::CHECK: {
+      monitor.print(F("cal: noise="));
+      monitor.print(calibrator.noise);
+      monitor.print(F(" counts, samples/point="));
+      monitor.println(calibrator.samplesNeeded());
+      float kg = calibrator.state == Calibrator::CHECK ? calibrator.checkKg : calibrator.referenceKg;
+      char text[9];
+      memcpy(text + 5, " kg", 4);
+      lcd.message("Poloz zavazi", formatDecimal(text, 5, (int)(kg * 10 + 0.5), 1));
+      break;
+    }
+    case Calibrator::DONE: {
+      // Factor was measured at the current gain, settings hold it at SCALE_GAIN
+      settings.scaleFactor = calibrator.factor / scaleGain * SCALE_GAIN;
+      scale.set_scale(calibrator.factor);
+      scale.set_offset(calibrator.zero);
+      StoredCalibration stored;
+      stored.value.factor = settings.scaleFactor;
+      stored.save();
+      saveZero();
+      zeroing.done = zeroKnown = true;
+      traceState();
+      monitor.print(F("cal: factor="));
+      monitor.print(settings.scaleFactor);
+      monitor.print(F(" offset="));
+      monitor.print(scale.get_offset());
+      monitor.print(F(" linearity="));
+      monitor.print(calibrator.linearityError, 3);
+      monitor.println(F(" kg, saved"));
+      lcd.message("Kalibrace", "ulozena");
+      break;
+    }
+    case Calibrator::FAILED:
+      monitor.print(F("cal: linearity error "));
+      monitor.print(calibrator.linearityError, 3);
+      monitor.println(F(" kg, not saved"));
+      lcd.message("Chyba", "linearity");
+      break;
+    default:
+      monitor.println(F("cal: cancelled"));
+      return;
   }
+  lcd.update();
+  if (!calibrator.active()) {
+    calibrator.cancel();
+    pause(CAL_RESULT_MS);
+  }
+}
+
+void exportLog() {
+  // Dump the session log at high speed, then return to the monitor baud rate
+  monitor.print(F("Log export at "));
+  monitor.println(EXPORT_BAUD);
+  Serial.flush();
+  Serial.begin(EXPORT_BAUD);
+  sessionLog.exportTo(Serial, [] { deadlines.kick(); });
+  Serial.flush();
+  Serial.begin(SERIAL_BAUD);
+}
+
+void acquire(float &distanceCm, float &weightKg) {
+  // Pipelined: the ping is triggered first and HX711 conversions are collected
+  // while the echo is in flight, so a pass takes the longer of the two instead
+  // of their sum. Sequential mode waits for the echo before weighing.
+  long sum = 0;
+  int count = 0, needed = scaleSamples();
+  unsigned long started = millis();
+  bool haveDistance = !health.rangerDue(started); // A faulty ranger is only retried now and then
+  distanceCm = -1; // Only a ranging from this pass counts
+  unsigned long timeout = ACQUIRE_TIMEOUT_MS + 1000UL * (needed + scaleDiscard) / (scaleFast ? SCALE_SPS_FAST : SCALE_SPS_SLOW);
 
-  float distanceCm = echoTime / (SOUND_TIME_US_PER_CM * 2);
+  while (!haveDistance || count < needed) {
+    if (millis() - started > timeout) break; // Dead sensor, use what arrived
+    deadlines.kick(); // Bounded by the timeout above
+    if (!haveDistance && ranger.poll(distanceCm)) {
+      trace.range(ranger.reading);
+      reportHealth(health.echo(distanceCm >= 0, millis()));
+      haveDistance = true;
+      heightSamples++;
+    }
+    if (!settings.pipeline && !haveDistance) continue;
+    if (count < needed) sampleWeight(sum, count);
+  }
+  reportHealth(health.scalePass(count));
+  if (!haveDistance) reportHealth(health.echo(false, millis())); // No ranging before the timeout
 
-  if (distanceCm > SENSOR_MOUNT_HEIGHT_CM || distanceCm < 10) {
-    return -1; // Out of range
+  weightKg = -1; // Scale not ready
+  if (count > 0) weightKg = (sum / count - scale.get_offset()) / scale.get_scale(); // Average weight over defined samples
+}
+
+float heightFromDistance(float distanceCm) {
+  if (distanceCm < 0 || distanceCm > settings.mountHeightCm) {
+    return -1; // Nobody under the sensor
   }
 
-  return SENSOR_MOUNT_HEIGHT_CM - distanceCm;
+  return settings.mountHeightCm - distanceCm;
 }
 
-float measureWeightKg() {
-  if (scale.is_ready()) {
-    return scale.get_units(SCALE_SAMPLES); // Average weight over defined samples
+void learnMountHeight(float distanceCm, float weightKg) {
+  if (weightKg < 0 || weightKg >= EMPTY_PLATFORM_KG) {
+    mountLearner.interrupt(); // Only an empty platform shows the floor
+    return;
   }
 
-  return -1; // Scale not ready
+  switch (mountLearner.add(distanceCm, settings.mountHeightCm)) {
+    case MountHeightLearner::OBSTRUCTED:
+      monitor.println(F("Ranger: floor distance jumped, sensor obstructed?"));
+      break;
+    case MountHeightLearner::CLEARED:
+      monitor.println(F("Ranger: floor visible again"));
+      break;
+    default:
+      break;
+  }
+}
+
+bool sampleWeight(long &sum, int &count) {
+  if (!scale.is_ready()) return false;
+  if (scaleDiscard > 0) {
+    readScale(); // Dropped while the HX711 filter settles
+    scaleDiscard--;
+    return false;
+  }
+  long value = readScale();
+  reportHealth(health.conversion(value));
+  if (!glitches.accept(scale.raw, glitchSlew(), glitchNoise())) return false; // Dropped, the next conversion is ~12 ms away
+  updateZero(value, (value - scale.get_offset()) / scale.get_scale());
+  sum += value;
+  count++;
+  weightSamples++;
+  swayPending = true;
+  return true;
+}
+
+void updateSway() {
+  if (!swayPending) return; // Same conversion as last time
+  swayPending = false;
+  long counts[Scale::CHANNELS];
+  for (int c = 0; c < Scale::CHANNELS; ++c) counts[c] = scale.trim[c] * (scale.raw[c] - scale.channelOffset[c]);
+  // Track only once someone is standing on the platform
+  sway.update(counts, Scale::CHANNELS, millis(), (long)fabs(scale.get_scale() * EMPTY_PLATFORM_KG));
+}
+
+void setScaleRate(bool fast) {
+  if (fast == scaleFast) return;
+  scaleFast = fast;
+  digitalWrite(PIN_SCALE_RATE, fast ? HIGH : LOW);
+  scaleDiscard = SCALE_RATE_SETTLE_CONVERSIONS;
+}
+
+void setScaleGain(byte gain) {
+  // Factor and offset were taken at SCALE_GAIN; both scale linearly with the gain
+  // (gain 32 reads channel B, which needs its own calibration)
+  if ((gain == 32) != (scaleGain == 32)) {
+    // The other input has its own zero, so A's offset means nothing there:
+    // the loop finds a new one as after "tare"
+    zeroing.restart();
+    zeroing.done = zeroKnown = false;
+  } else {
+    // Gains are powers of two, so the offset scales by an integer ratio: exact
+    // upwards, rounded to nearest downwards, and never overflows a long
+    long offset = scale.get_offset();
+    if (gain >= scaleGain) {
+      offset *= gain / scaleGain;
+    } else {
+      long divisor = scaleGain / gain;
+      offset = (offset + (offset < 0 ? -divisor : divisor) / 2) / divisor;
+    }
+    scale.set_offset(offset);
+  }
+  scale.set_scale(settings.scaleFactor / SCALE_GAIN * gain);
+  scale.set_gain(gain);
+  glitches.reset();
+  scaleGain = gain;
+  traceState();
+  scaleDiscard = SCALE_RATE_SETTLE_CONVERSIONS;
+}
+
+int scaleSamples() {
+  // 80 SPS is ~1.8x noisier (90 vs 50 nV rms), so average ~3.3x more samples
+  // for the same precision - still ~2.5x faster than the 10 SPS window
+  if (scaleFast) return (settings.scaleSamples * 13 + 3) / 4;
+  return settings.scaleSamples;
+}
+
+unsigned long loopDelayMs() {
+  if (scaleFast) return settings.loopDelayMs * SCALE_SPS_SLOW / SCALE_SPS_FAST;
+  return settings.loopDelayMs;
+}
+
+long readScale() {
+  long sum = scale.read();
+  trace.scale(scale.raw);
+  return sum;
+}
+
+// Per-channel counts for GLITCH_SLEW_KG and GLITCH_NOISE_KG at the current gain
+long glitchSlew() {
+  return fabs(scale.get_scale()) * GLITCH_SLEW_KG;
+}
+
+long glitchNoise() {
+  return fabs(scale.get_scale()) * GLITCH_NOISE_KG;
+}
+
+void traceState() {
+  trace.state(scale, settings.mountHeightCm);
+}
+
+// Boot zero from streaming conversions of an empty platform. Without a stored
+// zero any conversion may start it; with one only those near it do, so a
+// person standing on at power-up is not taken for zero. After "tare" the
+// zero is unknown, and conversions at any gain may take it.
+void updateZero(long value, float weightKg) {
+  if (zeroing.done || (zeroKnown && scaleGain != SCALE_GAIN)) return;
+  if (zeroKnown && fabs(weightKg) >= EMPTY_PLATFORM_KG) {
+    zeroing.restart();
+    return;
+  }
+  if (!zeroing.add(value, scale.raw, fabs(scale.get_scale()) * ZERO_SPREAD_KG)) return;
+
+  bool moved = fabs((zeroing.offset() - scale.get_offset()) / scale.get_scale()) > ZERO_SAVE_KG;
+  scale.offset = zeroing.offset();
+  for (int c = 0; c < Scale::CHANNELS; ++c) scale.channelOffset[c] = zeroing.channelOffset(c);
+  if (!zeroKnown || moved) saveZero();
+  if (!zeroKnown) monitor.println(F("Zero: found"));
+  zeroKnown = true;
+  traceState();
+}
+
+void saveZero() {
+  if (scaleGain != SCALE_GAIN) return; // Stored zeros are at SCALE_GAIN
+  StoredZero zero;
+  zero.value.offset = scale.get_offset();
+  memcpy(zero.value.channelOffset, scale.channelOffset, sizeof(zero.value.channelOffset));
+  zero.save();
+}
+
+void reportHealth(SensorHealth::Event event) {
+  switch (event) {
+    case SensorHealth::SCALE_FAULT:
+      monitor.println(F("Scale: no usable conversions, fault"));
+      break;
+    case SensorHealth::SCALE_OK:
+      monitor.println(F("Scale: recovered"));
+      break;
+    case SensorHealth::RANGER_FAULT:
+      monitor.println(F("Ranger: echoes lost, fault, weight only"));
+      break;
+    case SensorHealth::RANGER_OK:
+      monitor.println(F("Ranger: recovered"));
+      break;
+    default:
+      break;
+  }
+}
+
+// One line per session for scoring replays: time from stepping on to the
+// first complete result, or to stepping off without one
+void printResult(bool complete) {
+  monitor.print(F("Result: "));
+  monitor.print(millis() - occupiedMs);
+  if (!complete) {
+    monitor.println(F(" ms, none"));
+    return;
+  }
+  monitor.print(F(" ms, "));
+  monitor.print(result.weight);
+  monitor.print(F(" kg, "));
+  monitor.print(result.height);
+  monitor.println(F(" cm"));
+}
+
+// Stack high-water mark and the static objects that make up the SRAM budget
+#define PRINT_SIZE(object) listed += printSramItem(monitor, F(#object), sizeof(object))
+void printMemory() {
+  printSram(monitor);
+  uint16_t listed = 0;
+  PRINT_SIZE(Serial);
+  PRINT_SIZE(lcd);
+  PRINT_SIZE(history);
+  PRINT_SIZE(sessionLog);
+  PRINT_SIZE(console);
+  PRINT_SIZE(twi);
+  PRINT_SIZE(scale);
+  PRINT_SIZE(ranger);
+  PRINT_SIZE(stability);
+  PRINT_SIZE(calibrator);
+  PRINT_SIZE(mountLearner);
+  PRINT_SIZE(glitches);
+  PRINT_SIZE(health);
+  PRINT_SIZE(zeroing);
+  PRINT_SIZE(trace);
+  PRINT_SIZE(deadlines);
+  PRINT_SIZE(settings);
+  PRINT_SIZE(params);
+  PRINT_SIZE(timeLoop);
+  monitor.print(F("  listed: "));
+  monitor.println(listed);
 }
+#undef PRINT_SIZE
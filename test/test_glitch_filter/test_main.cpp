@@ -0,0 +1,90 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "glitch_filter.h"
+
+// --- Glitch Filter ---
+// One channel, 1000 counts of slew and 10 of noise; run with: pio test -e native
+
+const long SLEW = 1000, NOISE = 10;
+static GlitchFilter<1> filter; // static: the firmware, linked into the test, has its own
+
+void setUp() { filter = GlitchFilter<1>(); }
+void tearDown() {}
+
+static bool feed(long value, long *out = nullptr) {
+  long raw[1] = { value };
+  bool ok = filter.accept(raw, SLEW, NOISE);
+  if (out) *out = raw[0];
+  return ok;
+}
+
+void test_first_conversion_is_taken() {
+  TEST_ASSERT_TRUE(feed(123456));
+  TEST_ASSERT_TRUE(feed(123900));
+  TEST_ASSERT_EQUAL(0, filter.rejected());
+}
+
+void test_saturation_is_replaced_by_the_last_good_count() {
+  feed(5000);
+  long out;
+  TEST_ASSERT_FALSE(feed(0x7FFFFF, &out));
+  TEST_ASSERT_EQUAL(5000, out);
+  TEST_ASSERT_FALSE(feed(-0x800000, &out));
+  TEST_ASSERT_EQUAL(2, filter.saturated);
+}
+
+void test_bit_slips_are_rejected_within_slew() {
+  // Doubled, halved and negated counts, each caught even below SLEW
+  const long slips[] = { 1000, 250, -500, 1004 };
+  for (long s : slips) {
+    setUp();
+    feed(500);
+    long out;
+    TEST_ASSERT_FALSE(feed(s, &out));
+    TEST_ASSERT_EQUAL(500, out);
+    TEST_ASSERT_EQUAL(1, filter.slipped);
+  }
+}
+
+void test_noise_near_zero_is_not_a_slip() {
+  // -3 is minus 3 and 6 twice 3, but both are within the noise of 3
+  feed(3);
+  TEST_ASSERT_TRUE(feed(-3));
+  TEST_ASSERT_TRUE(feed(6));
+  TEST_ASSERT_EQUAL(0, filter.slipped);
+}
+
+void test_a_confirmed_jump_is_a_load_change() {
+  feed(5000);
+  long out;
+  TEST_ASSERT_FALSE(feed(60000, &out)); // Stepping on: one conversion held back
+  TEST_ASSERT_EQUAL(5000, out);
+  TEST_ASSERT_EQUAL(1, filter.slewed);
+  TEST_ASSERT_TRUE(feed(60400)); // Confirmed by the next one
+  TEST_ASSERT_TRUE(feed(60500));
+}
+
+void test_an_unconfirmed_spike_is_dropped() {
+  feed(5000);
+  TEST_ASSERT_FALSE(feed(90000));
+  TEST_ASSERT_TRUE(feed(5100)); // Back near the last good count
+  TEST_ASSERT_FALSE(feed(90000)); // Not confirmed by the old pending spike
+}
+
+void test_reset_takes_the_next_conversion() {
+  feed(5000);
+  filter.reset();
+  TEST_ASSERT_TRUE(feed(2500)); // After a gain change a halving is expected
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_first_conversion_is_taken);
+  RUN_TEST(test_saturation_is_replaced_by_the_last_good_count);
+  RUN_TEST(test_bit_slips_are_rejected_within_slew);
+  RUN_TEST(test_noise_near_zero_is_not_a_slip);
+  RUN_TEST(test_a_confirmed_jump_is_a_load_change);
+  RUN_TEST(test_an_unconfirmed_spike_is_dropped);
+  RUN_TEST(test_reset_takes_the_next_conversion);
+  return UNITY_END();
+}
@@ -0,0 +1,112 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "measurement_history.h"
+
+// --- Measurement History ---
+// Ring order and the window queries; run with: pio test -e native
+
+typedef MeasurementHistory<8> History;
+static History history; // static: the firmware, linked into the test, has its own
+
+void setUp() { history = History(); }
+void tearDown() {}
+
+static void pushWeights(const int16_t *dag, uint8_t n) {
+  for (uint8_t i = 0; i < n; ++i) history.push(i * 100, dag[i] / 100.0, 150);
+}
+
+// Sorts a copy and takes rank (n - 1) / 2
+static int16_t sortedMedian(const int16_t *v, uint8_t n) {
+  int16_t s[32];
+  memcpy(s, v, n * sizeof(int16_t));
+  for (uint8_t i = 1; i < n; ++i) {
+    for (uint8_t j = i; j > 0 && s[j - 1] > s[j]; --j) {
+      int16_t t = s[j]; s[j] = s[j - 1]; s[j - 1] = t;
+    }
+  }
+  return s[(n - 1) / 2];
+}
+
+void test_newest_sample_is_age_zero_and_the_ring_wraps() {
+  for (int i = 1; i <= 11; ++i) history.push(i, i, 100 + i);
+  TEST_ASSERT_EQUAL(8, history.size());
+  TEST_ASSERT_EQUAL(1100, history.at(0).weight);
+  TEST_ASSERT_EQUAL(400, history.at(7).weight);
+  TEST_ASSERT_EQUAL(1110, history.at(0).height);
+}
+
+void test_missing_readings_are_negative() {
+  history.push(0, -1, 250.04);
+  TEST_ASSERT_EQUAL(-1, history.at(0).weight);
+  TEST_ASSERT_EQUAL(2500, history.at(0).height);
+}
+
+void test_minimum_and_maximum_of_a_window() {
+  const int16_t dag[] = { 500, 300, 900, 100, 700 };
+  pushWeights(dag, 5);
+  TEST_ASSERT_EQUAL(100, history.minimum(History::WEIGHT, 5));
+  TEST_ASSERT_EQUAL(900, history.maximum(History::WEIGHT, 5));
+  TEST_ASSERT_EQUAL(100, history.minimum(History::WEIGHT, 2)); // 700, 100
+  TEST_ASSERT_EQUAL(900, history.maximum(History::WEIGHT, 3)); // 700, 100, 900
+  TEST_ASSERT_EQUAL(100, history.minimum(History::WEIGHT, 200)); // Clamped to the size
+}
+
+void test_median_is_the_lower_middle_sample() {
+  const int16_t dag[] = { 500, 100, 400, 200, 300 };
+  pushWeights(dag, 5);
+  TEST_ASSERT_EQUAL(300, history.median(History::WEIGHT, 5));
+  TEST_ASSERT_EQUAL(200, history.median(History::WEIGHT, 4)); // 100, 400, 200, 300
+  TEST_ASSERT_EQUAL(300, history.median(History::WEIGHT, 1));
+  TEST_ASSERT_EQUAL(300, history.median(History::WEIGHT, 99));
+  TEST_ASSERT_EQUAL(0, History().median(History::WEIGHT, 3)); // Empty
+}
+
+void test_median_matches_sorting() {
+  // Runs, duplicates and descending windows, every window length
+  const int16_t patterns[][8] = {
+    { 1, 2, 3, 4, 5, 6, 7, 8 },
+    { 8, 7, 6, 5, 4, 3, 2, 1 },
+    { 5, 5, 5, 5, 5, 5, 5, 5 },
+    { 3, 1, 3, 1, 3, 1, 3, 1 },
+    { 900, -1, 450, 450, 2, 901, 450, 0 },
+  };
+  for (const int16_t *p : patterns) {
+    history = History();
+    for (uint8_t i = 0; i < 8; ++i) history.push(0, p[i] / 100.0, 150);
+    for (uint8_t n = 1; n <= 8; ++n) {
+      int16_t window[8];
+      for (uint8_t i = 0; i < n; ++i) window[i] = history.at(i).weight;
+      TEST_ASSERT_EQUAL(sortedMedian(window, n), history.median(History::WEIGHT, n));
+    }
+  }
+  // Pseudo-random windows
+  uint32_t seed = 12345;
+  for (int round = 0; round < 200; ++round) {
+    history = History();
+    for (uint8_t i = 0; i < 8; ++i) {
+      seed = seed * 1103515245 + 12345;
+      history.push(0, (seed >> 16) % 50 / 10.0, 150);
+    }
+    uint8_t n = 1 + round % 8;
+    int16_t window[8];
+    for (uint8_t i = 0; i < n; ++i) window[i] = history.at(i).weight;
+    TEST_ASSERT_EQUAL(sortedMedian(window, n), history.median(History::WEIGHT, n));
+  }
+}
+
+void test_samples_within_a_time_window() {
+  for (uint16_t t = 0; t <= 700; t += 100) history.push(t, 50, 150);
+  TEST_ASSERT_EQUAL(3, history.samplesWithin(700, 200)); // 700, 600, 500
+  TEST_ASSERT_EQUAL(8, history.samplesWithin(700, 5000));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_newest_sample_is_age_zero_and_the_ring_wraps);
+  RUN_TEST(test_missing_readings_are_negative);
+  RUN_TEST(test_minimum_and_maximum_of_a_window);
+  RUN_TEST(test_median_is_the_lower_middle_sample);
+  RUN_TEST(test_median_matches_sorting);
+  RUN_TEST(test_samples_within_a_time_window);
+  return UNITY_END();
+}
@@ -0,0 +1,60 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "twi.h"
+#include "pcf8574_lcd.h"
+#include "twi_devices.h"
+
+// --- PCF8574 LCD ---
+// Pcf8574Lcd against the host's PCF8574 model (twi_devices.h) on the
+// modelled TWI bus; run with: pio test -e native
+
+extern Twi twi; // The firmware's, which its ISR(TWI_vect) serves
+static Pcf8574Lcd<16, 2> display; // static: the firmware has its own lcd
+
+static const char *const hello[2] = { "Hello           ", "world           " };
+static const char *const help[2] = { "Help            ", "world           " };
+
+void setUp() {
+  for (TwiRequest &r : twi.pool) twi.release(&r);
+  twi.head = twi.tail = nullptr;
+  twi.begin();
+  hostLcdExpander.present = true;
+  display = Pcf8574Lcd<16, 2>();
+  display.begin(twi, 0x27);
+}
+
+void tearDown() {}
+
+static unsigned long bytesFor(const char *const *rows) {
+  unsigned long before = hostLcdExpander.writes;
+  display.show(rows);
+  return hostLcdExpander.writes - before;
+}
+
+void test_only_changed_characters_are_sent() {
+  unsigned long full = bytesFor(hello);
+  TEST_ASSERT_TRUE(full > 0);
+  TEST_ASSERT_EQUAL(0, bytesFor(hello));
+  unsigned long diff = bytesFor(help); // "lo" becomes "p "
+  TEST_ASSERT_TRUE(diff > 0 && diff < full / 2);
+}
+
+void test_a_failed_frame_is_repainted() {
+  unsigned long full = bytesFor(hello);
+  hostLcdExpander.present = false; // Unplugged: the next frame is NACKed
+  bytesFor(help);
+  TEST_ASSERT_TRUE(display.damaged);
+  hostLcdExpander.present = true;
+  // Same rows again, yet every character goes out, the blanks too, which
+  // the first frame left out: what the display shows is unknown
+  TEST_ASSERT_TRUE(bytesFor(help) > full);
+  TEST_ASSERT_FALSE(display.damaged);
+  TEST_ASSERT_EQUAL(0, bytesFor(help));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_only_changed_characters_are_sent);
+  RUN_TEST(test_a_failed_frame_is_repainted);
+  return UNITY_END();
+}
@@ -0,0 +1,115 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "twi.h"
+#include "ranger.h"
+#include "twi_devices.h"
+
+// --- VL53L1X Ranger ---
+// Vl53l1xRanger against the host's VL53L1X model (twi_devices.h) on the
+// modelled TWI bus; run with: pio test -e native
+
+extern Twi twi; // The firmware's, which its ISR(TWI_vect) serves
+
+void setUp() {
+  for (TwiRequest &r : twi.pool) twi.release(&r);
+  twi.head = twi.tail = nullptr;
+  twi.begin();
+  hostVl53l1x.reset();
+  delay(2); // Past the sensor's boot
+}
+
+void tearDown() {}
+
+static uint8_t freeRequests() {
+  uint8_t n = 0;
+  for (TwiRequest &r : twi.pool) n += r.status == TwiRequest::FREE;
+  return n;
+}
+
+// Polls like loop() does until a measurement comes in, at most 200 ms
+static bool measure(Vl53l1xRanger &ranger, float &distanceCm) {
+  for (uint16_t i = 0; i < 400; ++i) {
+    if (ranger.poll(distanceCm)) return true;
+    delayMicroseconds(500);
+  }
+  return false;
+}
+
+void test_begin_configures_and_starts_ranging() {
+  Vl53l1xRanger ranger;
+  ranger.begin(twi);
+  TEST_ASSERT_EQUAL(Vl53l1xRanger::READY_CHECK, ranger.state);
+  TEST_ASSERT_EQUAL(Twi::POOL - 1, freeRequests());
+  TEST_ASSERT_EQUAL_HEX8(0x01, hostVl53l1x.reg(0x0030)); // Interrupt active high
+  TEST_ASSERT_EQUAL_HEX8(0x40, hostVl53l1x.reg(0x0087)); // Continuous ranging
+}
+
+void test_a_measurement_is_read_and_cleared() {
+  Vl53l1xRanger ranger;
+  ranger.begin(twi);
+  hostVl53l1x.distanceMm = 1834;
+  float cm = 0;
+  TEST_ASSERT_TRUE(measure(ranger, cm));
+  TEST_ASSERT_EQUAL_FLOAT(183.4, cm);
+  TEST_ASSERT_EQUAL(1834, ranger.reading);
+
+  hostVl53l1x.distanceMm = 1500;
+  TEST_ASSERT_TRUE(measure(ranger, cm));
+  TEST_ASSERT_EQUAL_FLOAT(150.0, cm);
+}
+
+void test_ranging_runs_at_the_set_period() {
+  Vl53l1xRanger ranger;
+  ranger.begin(twi);
+  unsigned long first = hostVl53l1x.measurements;
+  float cm;
+  uint8_t results = 0;
+  for (uint16_t i = 0; i < 2000; ++i) { // 1 s
+    results += ranger.poll(cm);
+    delayMicroseconds(500);
+  }
+  // 25 Hz, each one read before the next: none lost to a raised interrupt
+  TEST_ASSERT_UINT_WITHIN(1, 1000 / Vl53l1xRanger::PERIOD_MS, results);
+  TEST_ASSERT_EQUAL(results, hostVl53l1x.measurements - first);
+}
+
+void test_an_invalid_range_is_no_reading() {
+  Vl53l1xRanger ranger;
+  ranger.begin(twi);
+  hostVl53l1x.rangeStatus = 2; // Signal fail
+  float cm = 0;
+  TEST_ASSERT_TRUE(measure(ranger, cm));
+  TEST_ASSERT_EQUAL_FLOAT(-1, cm);
+  TEST_ASSERT_EQUAL(0, ranger.reading);
+}
+
+void test_a_missing_sensor_returns_its_request() {
+  hostVl53l1x.present = false;
+  Vl53l1xRanger ranger;
+  ranger.begin(twi);
+  TEST_ASSERT_EQUAL(Vl53l1xRanger::ABSENT, ranger.state);
+  TEST_ASSERT_EQUAL(Twi::POOL, freeRequests());
+  float cm = 0;
+  TEST_ASSERT_TRUE(ranger.poll(cm));
+  TEST_ASSERT_EQUAL_FLOAT(-1, cm);
+}
+
+void test_another_device_at_the_address_is_not_used() {
+  hostVl53l1x.setReg(0x010F, 0xEE); // A VL53L0X's model ID
+  Vl53l1xRanger ranger;
+  ranger.begin(twi);
+  TEST_ASSERT_EQUAL(Vl53l1xRanger::ABSENT, ranger.state);
+  TEST_ASSERT_EQUAL(Twi::POOL, freeRequests());
+  TEST_ASSERT_EQUAL_HEX8(0x00, hostVl53l1x.reg(0x0087)); // Never started
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_begin_configures_and_starts_ranging);
+  RUN_TEST(test_a_measurement_is_read_and_cleared);
+  RUN_TEST(test_ranging_runs_at_the_set_period);
+  RUN_TEST(test_an_invalid_range_is_no_reading);
+  RUN_TEST(test_a_missing_sensor_returns_its_request);
+  RUN_TEST(test_another_device_at_the_address_is_not_used);
+  return UNITY_END();
+}
@@ -0,0 +1,171 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "session_log.h"
+
+// --- Session Log ---
+// Batching, the lap search that finds the write position after a reboot,
+// and the oldest-first export; run with: pio test -e native
+
+// Seven slots, so a few appends wrap the log
+struct SmallStore {
+  static const uint16_t SLOTS = 7;
+  static LogRecord slots[SLOTS];
+  static unsigned long writes;
+
+  void begin() {}
+  void read(uint16_t slot, LogRecord &r) { r = slots[slot]; }
+  void write(uint16_t slot, const LogRecord *r, uint8_t n) {
+    for (uint8_t i = 0; i < n; ++i) slots[slot + i] = r[i];
+    writes++;
+  }
+};
+LogRecord SmallStore::slots[SmallStore::SLOTS];
+unsigned long SmallStore::writes;
+
+typedef SessionLog<SmallStore, 4> Log;
+
+// Export output, one buffer
+struct Text : Print {
+  char text[1024];
+  size_t length = 0;
+
+  size_t write(uint8_t b) override {
+    if (b != '\r' && length < sizeof(text) - 1) text[length++] = b;
+    text[length] = 0;
+    return 1;
+  }
+  using Print::write;
+};
+
+void setUp() {
+  memset(SmallStore::slots, 0xFF, sizeof(SmallStore::slots)); // Erased
+  SmallStore::writes = 0;
+}
+
+void tearDown() {}
+
+// Sessions weigh 1, 2, 3... kg so the export shows their order
+static void appendSessions(Log &log, int from, int to) {
+  for (int i = from; i <= to; ++i) log.append(i, 150.0 + i, i & 3);
+  log.flush();
+}
+
+void test_empty_log_starts_at_slot_zero() {
+  Log log;
+  log.begin();
+  TEST_ASSERT_EQUAL(0, log.head);
+  TEST_ASSERT_EQUAL(0, log.lap);
+}
+
+void test_records_are_written_a_batch_at_a_time() {
+  Log log;
+  log.begin();
+  for (int i = 1; i <= 3; ++i) log.append(i, 150, 1);
+  TEST_ASSERT_FALSE(log.batchFull());
+  TEST_ASSERT_EQUAL(0, SmallStore::writes);
+  log.append(4, 150, 1);
+  TEST_ASSERT_TRUE(log.batchFull());
+  log.append(5, 150, 1); // A full batch is written before the next append
+  TEST_ASSERT_EQUAL(1, SmallStore::writes);
+  TEST_ASSERT_EQUAL(400, SmallStore::slots[3].weight);
+  TEST_ASSERT_EQUAL(LogRecord::LAP_ERASED, SmallStore::slots[4].lap());
+}
+
+void test_record_fields_round_trip() {
+  Log log;
+  log.begin();
+  log.append(72.34, 181.76, 2);
+  log.flush();
+  const LogRecord &r = SmallStore::slots[0];
+  TEST_ASSERT_EQUAL(7234, r.weight);
+  TEST_ASSERT_EQUAL(1818, r.heightMm());
+  TEST_ASSERT_EQUAL(2, r.category());
+  TEST_ASSERT_EQUAL(0, r.lap());
+}
+
+// After a reboot the next append must land after the newest record
+void test_reboot_finds_the_write_position() {
+  const int counts[] = { 1, 5, 6, 7, 8, 10, 14, 21, 23 };
+  for (int n : counts) {
+    setUp();
+    Log before;
+    before.begin();
+    appendSessions(before, 1, n);
+
+    Log after;
+    after.begin();
+    TEST_ASSERT_EQUAL(before.head, after.head);
+    TEST_ASSERT_EQUAL(before.lap, after.lap);
+    TEST_ASSERT_EQUAL(n % SmallStore::SLOTS, after.head);
+    TEST_ASSERT_EQUAL((n / SmallStore::SLOTS) % 3, after.lap);
+  }
+}
+
+void test_export_is_oldest_first() {
+  Log log;
+  log.begin();
+  appendSessions(log, 1, 10); // Sessions 1-3 are overwritten
+  Text out;
+  log.exportTo(out);
+  const char *expected =
+    "# delta_s,weight_kg,height_cm,category\n"
+    "0,4.00,154.0,0\n"
+    "0,5.00,155.0,1\n"
+    "0,6.00,156.0,2\n"
+    "0,7.00,157.0,3\n"
+    "0,8.00,158.0,0\n"
+    "0,9.00,159.0,1\n"
+    "0,10.00,160.0,2\n"
+    "# end\n";
+  TEST_ASSERT_EQUAL_STRING(expected, out.text);
+}
+
+void test_export_skips_erased_slots() {
+  Log log;
+  log.begin();
+  log.append(50, 170, 1); // Still pending: the export flushes it first
+  Text out;
+  log.exportTo(out);
+  TEST_ASSERT_EQUAL_STRING("# delta_s,weight_kg,height_cm,category\n0,50.00,170.0,1\n# end\n", out.text);
+}
+
+static int exported = 0;
+static void countRecord() { exported++; }
+
+void test_export_reports_each_record() {
+  Log log;
+  log.begin();
+  appendSessions(log, 1, 10);
+  Text out;
+  exported = 0;
+  log.exportTo(out, countRecord); // The firmware kicks the watchdog here
+  TEST_ASSERT_EQUAL(7, exported);
+}
+
+void test_eeprom_store_survives_a_reboot() {
+  for (int i = EEPROM_LOG_START; i < EEPROM_LOG_END; ++i) EEPROM.write(i, 0xFF);
+  SessionLog<EepromLogStore> before;
+  before.begin();
+  for (int i = 1; i <= 6; ++i) before.append(60 + i, 170, 1);
+  before.flush();
+
+  SessionLog<EepromLogStore> after;
+  after.begin();
+  TEST_ASSERT_EQUAL(6, after.head);
+  LogRecord r;
+  after.store.read(5, r);
+  TEST_ASSERT_EQUAL(6600, r.weight);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_log_starts_at_slot_zero);
+  RUN_TEST(test_records_are_written_a_batch_at_a_time);
+  RUN_TEST(test_record_fields_round_trip);
+  RUN_TEST(test_reboot_finds_the_write_position);
+  RUN_TEST(test_export_is_oldest_first);
+  RUN_TEST(test_export_skips_erased_slots);
+  RUN_TEST(test_export_reports_each_record);
+  RUN_TEST(test_eeprom_store_survives_a_reboot);
+  return UNITY_END();
+}
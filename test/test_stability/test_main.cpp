@@ -0,0 +1,115 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "measurement_history.h"
+#include "stability.h"
+
+// --- Stability Policies ---
+// Each policy on the same synthetic weights, tolerance 20 dag (0.2 kg) and
+// three stable readings; run with: pio test -e native
+
+typedef MeasurementHistory<32> History;
+const int16_t TOLERANCE = 20;
+const uint8_t REQUIRED = 3;
+static History history; // static: the firmware, linked into the test, has its own
+
+void setUp() { history = History(); }
+void tearDown() {}
+
+// Pushes one weight in dag and updates the policy; true once it is stable
+template<typename Policy>
+static bool feed(Policy &policy, int16_t dag, bool swaying = false) {
+  history.push(0, dag / 100.0, 150);
+  policy.update(history, History::WEIGHT, TOLERANCE, REQUIRED, swaying);
+  return policy.stable;
+}
+
+// Readings until the policy settles on a steady 70 kg, 0 if it never does
+template<typename Policy>
+static int settleSteady() {
+  Policy policy;
+  for (int n = 1; n <= 20; ++n) if (feed(policy, 7000 + (n & 1) * 5)) return n;
+  return 0;
+}
+
+// Same, with the weight creeping 15 dag per reading: each pair is within
+// the tolerance, the window is not
+template<typename Policy>
+static bool settlesOnDrift() {
+  Policy policy;
+  for (int n = 0; n < 20; ++n) if (feed(policy, 7000 + n * 15)) return true;
+  return false;
+}
+
+void test_every_policy_settles_on_a_steady_weight() {
+  // The first reading has no pair: REQUIRED pairs need REQUIRED + 1 readings
+  TEST_ASSERT_EQUAL(REQUIRED + 1, settleSteady<ConsecutiveDeltaPolicy>());
+  TEST_ASSERT_EQUAL(REQUIRED + 1, settleSteady<WindowedRangePolicy>());
+  TEST_ASSERT_EQUAL(REQUIRED + 1, settleSteady<WindowedVariancePolicy>());
+  TEST_ASSERT_EQUAL(REQUIRED + 1, settleSteady<ModelPolicy>());
+}
+
+void test_slow_drift_passes_only_consecutive_pairs() {
+  TEST_ASSERT_TRUE(settlesOnDrift<ConsecutiveDeltaPolicy>());
+  TEST_ASSERT_FALSE(settlesOnDrift<WindowedRangePolicy>());
+  TEST_ASSERT_FALSE(settlesOnDrift<ModelPolicy>());
+}
+
+void test_a_jump_restarts_consecutive_pairs() {
+  ConsecutiveDeltaPolicy policy;
+  for (int i = 0; i < 4; ++i) feed(policy, 7000);
+  TEST_ASSERT_TRUE(policy.stable);
+  TEST_ASSERT_FALSE(feed(policy, 7100)); // Moved
+  TEST_ASSERT_EQUAL(0, policy.count);
+  TEST_ASSERT_FALSE(feed(policy, 7100));
+  TEST_ASSERT_FALSE(feed(policy, 7100));
+  TEST_ASSERT_TRUE(feed(policy, 7100));
+}
+
+void test_sway_counts_as_movement() {
+  ConsecutiveDeltaPolicy pairs;
+  WindowedVariancePolicy variance;
+  for (int i = 0; i < 6; ++i) {
+    feed(pairs, 7000, true);
+    feed(variance, 7000, true);
+  }
+  TEST_ASSERT_FALSE(pairs.stable);
+  TEST_ASSERT_FALSE(variance.stable);
+}
+
+void test_variance_tolerates_one_outlier() {
+  // One reading 21 dag off breaks two pairs, but keeps the sd within half
+  // the tolerance
+  const int16_t dag[] = { 7000, 7000, 7000, 7000, 7021, 7000 };
+  WindowedVariancePolicy variance;
+  for (int16_t d : dag) feed(variance, d);
+  TEST_ASSERT_TRUE(variance.stable);
+
+  history = History();
+  ConsecutiveDeltaPolicy pairs;
+  for (int16_t d : dag) feed(pairs, d);
+  TEST_ASSERT_FALSE(pairs.stable);
+}
+
+void test_noise_floor_tolerance_and_sample_count() {
+  NoiseFloor noise;
+  for (int i = 0; i < NoiseFloor::MIN_SAMPLES - 1; ++i) noise.add(i & 1 ? 4 : -4);
+  TEST_ASSERT_FALSE(noise.known());
+  noise.add(4);
+  TEST_ASSERT_TRUE(noise.known());
+  // Mean pair difference 4: pair sd ~5, so 3 sds ~15
+  TEST_ASSERT_EQUAL(15, noise.tolerance(3));
+  // (15 / 5)^2 / 2 = 4.5: five readings put the mean within 5 at 3 sds
+  TEST_ASSERT_EQUAL(5, noise.samplesWithin(5, 3));
+  TEST_ASSERT_EQUAL(1, noise.samplesWithin(20, 3));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_every_policy_settles_on_a_steady_weight);
+  RUN_TEST(test_slow_drift_passes_only_consecutive_pairs);
+  RUN_TEST(test_a_jump_restarts_consecutive_pairs);
+  RUN_TEST(test_sway_counts_as_movement);
+  RUN_TEST(test_variance_tolerates_one_outlier);
+  RUN_TEST(test_noise_floor_tolerance_and_sample_count);
+  return UNITY_END();
+}
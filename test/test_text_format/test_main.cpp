@@ -0,0 +1,106 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <stdio.h>
+#include <time.h>
+#include "text_format.h"
+
+// --- Fixed-Width Number Formatting ---
+// formatDecimal against printf's text, and against the snprintf/dtostrf
+// code it replaced in BMI_Display; run with: pio test -e native
+//
+// The benchmark counts host CPU time, not AVR cycles: it shows the ratio,
+// "prof" on env:profile shows what the display stage costs on the board.
+
+static void expectText(const char *expected, int width, int value, int decimals) {
+  char out[8];
+  formatDecimal(out, width, value, decimals);
+  TEST_ASSERT_EQUAL_MEMORY(expected, out, width);
+}
+
+void test_integers_match_printf() {
+  for (int v = -999; v <= 9999; ++v) {
+    char expected[8];
+    snprintf(expected, sizeof(expected), "%4d", v);
+    expectText(expected, 4, v, 0);
+  }
+}
+
+void test_one_decimal_matches_printf() {
+  for (int v = -99; v <= 999; ++v) { // Tenths, the BMI's range
+    char expected[8];
+    snprintf(expected, sizeof(expected), "%4.1f", v / 10.0);
+    expectText(expected, 4, v, 1);
+  }
+}
+
+void test_overflow_fills_the_field() {
+  expectText("###", 3, 1000, 0);
+  expectText("###", 3, -100, 0);
+  expectText("####", 4, 1000, 1);
+}
+
+void test_returns_the_first_character() {
+  char out[5];
+  TEST_ASSERT_EQUAL_PTR(out + 2, formatDecimal(out, 5, 55, 1));
+}
+
+// --- Benchmark ---
+// The formatting of one result screen: weight, height and BMI
+
+static void formatOld(char *weight, char *height, char *bmi, int kg, int cm, float value) {
+  static const char emptyline[] = "                ";
+  char buffer[50];
+  int chars = snprintf(weight, 8, "%d kg", kg);
+  if (8 > chars) memcpy(weight + chars, emptyline, 8 - chars);
+  chars = snprintf(height, 7, "%d cm", cm);
+  if (7 > chars) memcpy(height + chars, emptyline, 7 - chars);
+  snprintf(buffer, sizeof(buffer), "%2.1f", value); // dtostrf(value, 2, 1, buffer)
+  memcpy(bmi, buffer, 4);
+  chars = strlen(bmi);
+  if (4 > chars) memcpy(bmi + chars, emptyline, 4 - chars);
+}
+
+static void formatNew(char *weight, char *height, char *bmi, int kg, int cm, float value) {
+  formatDecimal(weight, 4, kg);
+  memcpy(weight + 4, " kg ", 4);
+  formatDecimal(height, 3, cm);
+  memcpy(height + 3, " cm ", 4);
+  formatDecimal(bmi, 4, (int)(value * 10 + 0.5), 1);
+}
+
+typedef void (*Formatter)(char *, char *, char *, int, int, float);
+
+static double nsPerScreen(Formatter format) {
+  const long SCREENS = 200000;
+  char weight[9], height[8], bmi[5];
+  volatile char sink = 0;
+  clock_t start = clock();
+  for (long i = 0; i < SCREENS; ++i) {
+    int kg = 40 + i % 80, cm = 140 + i % 60;
+    format(weight, height, bmi, kg, cm, 10000.0 * kg / cm / cm);
+    sink = sink + weight[3] + height[2] + bmi[3];
+  }
+  return (clock() - start) * 1e9 / CLOCKS_PER_SEC / SCREENS;
+}
+
+void test_faster_than_snprintf_and_dtostrf() {
+  double oldNs = nsPerScreen(formatOld), newNs = nsPerScreen(formatNew);
+  char message[96];
+  snprintf(message, sizeof(message), "result screen: snprintf/dtostrf %.0f ns, formatDecimal %.0f ns (%.1fx)",
+           oldNs, newNs, oldNs / newNs);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_TRUE(newNs < oldNs);
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_integers_match_printf);
+  RUN_TEST(test_one_decimal_matches_printf);
+  RUN_TEST(test_overflow_fills_the_field);
+  RUN_TEST(test_returns_the_first_character);
+  RUN_TEST(test_faster_than_snprintf_and_dtostrf);
+  return UNITY_END();
+}
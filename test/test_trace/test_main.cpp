@@ -0,0 +1,188 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "trace.h"
+
+// --- Trace Codec ---
+// Frames written by TraceWriter come back out of TraceReader with the same
+// values, at their recorded times; run with: pio test -e native
+
+struct TwoCells : HX711Units<TwoCells, 2> {
+  long read() { return trimmedSum(); }
+};
+
+// What the writer sent, replayed as the reader's serial input
+struct Capture : Stream {
+  uint8_t bytes[512];
+  size_t length = 0, position = 0;
+  unsigned long acks = 0;
+
+  size_t write(uint8_t b) override {
+    if (position) { // Reading back: only the reader's flow control is written
+      if (b == TRACE_ACK) acks++;
+      return 1;
+    }
+    if (length < sizeof(bytes)) bytes[length++] = b;
+    return 1;
+  }
+  using Print::write;
+  int available() override { return length - position; }
+  int read() override { return position < length ? bytes[position++] : -1; }
+  int peek() override { return position < length ? bytes[position] : -1; }
+};
+
+// static: the firmware, linked into the test, has globals of its own
+static Capture capture;
+static TwoCells source, target;
+static TraceWriter<TwoCells> writer;
+static TraceReader<TwoCells> reader;
+static float mountHeight;
+
+void setUp() {
+  capture = Capture();
+  source = TwoCells();
+  target = TwoCells();
+  writer = TraceWriter<TwoCells>();
+  reader = TraceReader<TwoCells>();
+  mountHeight = 0;
+}
+
+void tearDown() {}
+
+void test_zigzag_round_trips() {
+  const int32_t values[] = { 0, -1, 1, -2, 2, 8388607, -8388608, INT32_MAX, INT32_MIN };
+  const uint32_t coded[] = { 0, 1, 2, 3, 4, 16777214, 16777215, 0xFFFFFFFE, 0xFFFFFFFF };
+  for (uint8_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+    TEST_ASSERT_EQUAL_UINT32(coded[i], traceZigzag(values[i]));
+    TEST_ASSERT_EQUAL_INT32(values[i], traceUnzigzag(coded[i]));
+  }
+}
+
+void test_varint_lengths() {
+  uint8_t out[5];
+  TEST_ASSERT_EQUAL(1, traceVarint(out, 0));
+  TEST_ASSERT_EQUAL_HEX8(0x00, out[0]);
+  TEST_ASSERT_EQUAL(1, traceVarint(out, 127));
+  TEST_ASSERT_EQUAL_HEX8(0x7F, out[0]);
+  TEST_ASSERT_EQUAL(2, traceVarint(out, 128));
+  TEST_ASSERT_EQUAL_HEX8(0x80, out[0]);
+  TEST_ASSERT_EQUAL_HEX8(0x01, out[1]);
+  TEST_ASSERT_EQUAL(5, traceVarint(out, 0xFFFFFFFF));
+  TEST_ASSERT_EQUAL_HEX8(0x0F, out[4]);
+}
+
+void test_float_bits_round_trip() {
+  const float values[] = { 0.0, -21300.0, 1.0375, 250.0 };
+  for (float f : values) TEST_ASSERT_EQUAL_FLOAT(f, traceBitsFloat(traceFloatBits(f)));
+}
+
+// Polls the reader every millisecond until the trace is used up
+static void replayAll(long raw[][2], uint8_t &scales, long *readings, uint8_t &ranges) {
+  scales = ranges = 0;
+  reader.begin(capture, target, mountHeight);
+  for (uint16_t ms = 0; ms < 200; ++ms) {
+    if (reader.ready(TRACE_SCALE)) {
+      memcpy(raw[scales++], reader.raw, sizeof(reader.raw));
+      reader.take(TRACE_SCALE);
+    }
+    if (reader.ready(TRACE_RANGE)) {
+      readings[ranges++] = reader.reading;
+      reader.take(TRACE_RANGE);
+    }
+    delay(1);
+  }
+}
+
+void test_records_round_trip() {
+  source.offset = -123456;
+  source.factor = -21300.5;
+  source.channelOffset[0] = -61000;
+  source.channelOffset[1] = -62456;
+  source.trim[1] = 1.0375;
+  writer.begin(capture);
+  writer.state(source, 231.5);
+  long first[2] = { 8388606, -8388607 }, second[2] = { -1, 0 };
+  writer.scale(first);
+  delay(12);
+  writer.range(5831);
+  delay(12);
+  writer.scale(second);
+  delay(12);
+  writer.range(0);
+  writer.end();
+
+  long raw[8][2], readings[8];
+  uint8_t scales, ranges;
+  replayAll(raw, scales, readings, ranges);
+  TEST_ASSERT_EQUAL(2, scales);
+  TEST_ASSERT_EQUAL_MEMORY(first, raw[0], sizeof(first));
+  TEST_ASSERT_EQUAL_MEMORY(second, raw[1], sizeof(second));
+  TEST_ASSERT_EQUAL(2, ranges);
+  TEST_ASSERT_EQUAL(5831, readings[0]);
+  TEST_ASSERT_EQUAL(0, readings[1]);
+
+  TEST_ASSERT_EQUAL(source.offset, target.offset);
+  TEST_ASSERT_EQUAL_FLOAT(source.factor, target.factor);
+  TEST_ASSERT_EQUAL(source.channelOffset[1], target.channelOffset[1]);
+  TEST_ASSERT_EQUAL_FLOAT(source.trim[1], target.trim[1]);
+  TEST_ASSERT_EQUAL_FLOAT(231.5, mountHeight);
+  TEST_ASSERT_EQUAL(5, capture.acks); // One per frame
+}
+
+void test_text_stays_off_the_timeline() {
+  writer.begin(capture);
+  long raw[2] = { 1000, 2000 };
+  delay(20);
+  writer.text("Height: 180.00 cm\n", 18);
+  delay(20);
+  writer.scale(raw);
+
+  // The scale record is due 40 ms after the start, as captured
+  reader.begin(capture, target, mountHeight);
+  delay(35);
+  TEST_ASSERT_FALSE(reader.ready(TRACE_SCALE));
+  delay(10);
+  TEST_ASSERT_TRUE(reader.ready(TRACE_SCALE));
+  TEST_ASSERT_EQUAL_MEMORY(raw, reader.raw, sizeof(raw));
+  TEST_ASSERT_FALSE(reader.ready(TRACE_RANGE));
+}
+
+void test_only_the_latest_reading_is_kept() {
+  writer.begin(capture);
+  for (long i = 1; i <= 3; ++i) {
+    long raw[2] = { i, -i };
+    writer.scale(raw);
+    delay(10);
+  }
+
+  // A reader that looks only after all three came due sees the last one
+  reader.begin(capture, target, mountHeight);
+  delay(50);
+  TEST_ASSERT_TRUE(reader.ready(TRACE_SCALE));
+  TEST_ASSERT_EQUAL(3, reader.raw[0]);
+  TEST_ASSERT_EQUAL(-3, reader.raw[1]);
+  reader.take(TRACE_SCALE);
+  TEST_ASSERT_FALSE(reader.ready(TRACE_SCALE));
+}
+
+void test_garbage_before_sync_is_skipped() {
+  capture.write((uint8_t)0x00);
+  capture.write((uint8_t)0x42);
+  writer.begin(capture);
+  writer.range(4321);
+  reader.begin(capture, target, mountHeight);
+  delay(5);
+  TEST_ASSERT_TRUE(reader.ready(TRACE_RANGE));
+  TEST_ASSERT_EQUAL(4321, reader.reading);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_zigzag_round_trips);
+  RUN_TEST(test_varint_lengths);
+  RUN_TEST(test_float_bits_round_trip);
+  RUN_TEST(test_records_round_trip);
+  RUN_TEST(test_text_stays_off_the_timeline);
+  RUN_TEST(test_only_the_latest_reading_is_kept);
+  RUN_TEST(test_garbage_before_sync_is_skipped);
+  return UNITY_END();
+}
@@ -0,0 +1,198 @@
+#!/usr/bin/env python3
+"""Tune the tuning.h parameters by replaying recorded sessions.
+
+Every candidate parameter set is replayed over a corpus of traces by the
+native build (pio run -e native), in parallel on all cores. Each session is
+scored against the reference weight and height measured for it. The tool
+prints the Pareto front of time-to-result, measurement error and false-accept
+rate, and writes the chosen point as a header for TUNING_HEADER.
+
+  autotune.py [--corpus DIR] [--random N] [--out FILE]
+
+The corpus holds NAME.trace files captured with "trace.py capture". Each
+trace has a NAME.truth file next to it with one "weight_kg height_cm" line
+per session, in the order the people stepped on.
+
+A result is a false accept when it is off by more than --accept-kg or
+--accept-cm. Error is the mean of |weight error| / accept-kg and
+|height error| / accept-cm, so 1.0 sits at the false-accept limit. Sessions
+without a result (stepped off first) count as misses. Candidates that miss
+more than --max-miss of the sessions are left out of the front.
+
+The stability policy is fixed at build time. To tune another, build the
+replay with -DSTABILITY_POLICY=NAME and pass --policy NAME, which goes into
+the written header too.
+"""
+import argparse
+import itertools
+import os
+import random
+import re
+import subprocess
+import sys
+from concurrent.futures import ThreadPoolExecutor
+
+# Console setting, tuning.h constant, C type, default grid
+PARAMS = [
+    ("weight_tol", "WEIGHT_TOLERANCE_KG", "float", [0.5, 1.0, 2.0, 3.0]),
+    ("height_tol", "HEIGHT_TOLERANCE_CM", "float", [1.0, 2.0, 3.0, 5.0]),
+    ("stable_count", "STABLE_READINGS_REQUIRED", "int", [2, 3, 5, 8]),
+    ("samples", "SCALE_SAMPLES", "int", [3, 5, 8]),
+    ("loop_delay", "LOOP_DELAY_MS", "unsigned long", [100, 250, 500]),
+]
+
+TOTALS = ("sessions", "answered", "results", "ms", "error", "kg", "cm", "false")
+RESULT = re.compile(r"^Result: (\d+) ms, (?:none|([-\d.]+) kg, ([-\d.]+) cm)")
+
+
+def load_corpus(directory):
+    corpus = []
+    for name in sorted(os.listdir(directory)):
+        if not name.endswith(".trace"):
+            continue
+        trace = os.path.join(directory, name)
+        truth = trace[:-len(".trace")] + ".truth"
+        if not os.path.exists(truth):
+            sys.exit(f"{trace} has no {os.path.basename(truth)}")
+        with open(truth) as f:
+            sessions = [tuple(map(float, line.split()[:2])) for line in f if line.strip()]
+        corpus.append((trace, sessions))
+    if not corpus:
+        sys.exit(f"no .trace files in {directory}")
+    return corpus
+
+
+def replay(program, trace, candidate):
+    """Result lines of one replay: (ms, kg, cm), kg and cm None for no result."""
+    args = [program]
+    for (setting, _, _, _), value in zip(PARAMS, candidate):
+        args += ["--set", f"{setting}={value}"]
+    out = subprocess.run(args + [trace], capture_output=True, text=True, check=True).stdout
+    results = []
+    for line in out.splitlines():
+        m = RESULT.match(line)
+        if m:
+            kg, cm = m.group(2), m.group(3)
+            results.append((int(m.group(1)), kg and float(kg), cm and float(cm)))
+    return results
+
+
+def score(results, sessions, args):
+    """Sums over one trace; sessions and results pair up in order."""
+    s = dict.fromkeys(TOTALS, 0)
+    for i in range(max(len(results), len(sessions))):
+        if i >= len(sessions):  # a result nobody stepped on for
+            s["results"] += 1
+            s["false"] += 1
+            continue
+        s["sessions"] += 1
+        if i >= len(results) or results[i][1] is None:
+            continue  # missed
+        ms, kg, cm = results[i]
+        dkg, dcm = abs(kg - sessions[i][0]), abs(cm - sessions[i][1])
+        s["results"] += 1
+        s["answered"] += 1
+        s["ms"] += ms
+        s["kg"] += dkg
+        s["cm"] += dcm
+        s["error"] += (dkg / args.accept_kg + dcm / args.accept_cm) / 2
+        s["false"] += dkg > args.accept_kg or dcm > args.accept_cm
+    return s
+
+
+def evaluate(args, corpus, candidates):
+    jobs = [(c, trace, sessions) for c in candidates for trace, sessions in corpus]
+    with ThreadPoolExecutor(args.jobs) as pool:
+        runs = pool.map(lambda job: replay(args.program, job[1], job[0]), jobs)
+        totals = {}
+        for done, ((candidate, _, sessions), results) in enumerate(zip(jobs, runs), 1):
+            t = totals.setdefault(candidate, dict.fromkeys(TOTALS, 0))
+            for key, value in score(results, sessions, args).items():
+                t[key] += value
+            print(f"\r{done}/{len(jobs)} replays", end="", file=sys.stderr)
+    print(file=sys.stderr)
+
+    rows = []
+    for candidate, t in totals.items():
+        n = t["results"] or 1
+        rows.append(dict(
+            candidate=candidate,
+            time=t["ms"] / n / 1000,
+            error=t["error"] / n,
+            kg=t["kg"] / n,
+            cm=t["cm"] / n,
+            false=t["false"] / n,
+            missed=1 - t["answered"] / (t["sessions"] or 1),
+        ))
+    return rows
+
+
+def pareto(rows):
+    keys = ("time", "error", "false")
+
+    def dominates(a, b):
+        return all(a[k] <= b[k] for k in keys) and any(a[k] < b[k] for k in keys)
+
+    return sorted((r for r in rows if not any(dominates(o, r) for o in rows)), key=lambda r: r["time"])
+
+
+def header(row, policy):
+    lines = ["#pragma once", "", "// --- Pipeline Tuning ---",
+             f"// Written by tools/autotune.py: {row['time']:.2f} s to a result, weight error "
+             f"{row['kg']:.2f} kg, height error {row['cm']:.2f} cm,",
+             f"// {row['false'] * 100:.1f} % false accepts, {row['missed'] * 100:.1f} % missed on the corpus"]
+    for (_, constant, ctype, _), value in zip(PARAMS, row["candidate"]):
+        lines.append(f"const {ctype} {constant} = {value};")
+    if policy:
+        lines.append(f"#define STABILITY_POLICY {policy}")
+    return "\n".join(lines) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--program", default=".pio/build/native/program", help="native replay build")
+    parser.add_argument("--corpus", default="corpus")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count())
+    parser.add_argument("--random", type=int, metavar="N", help="score N random grid points instead of all")
+    parser.add_argument("--accept-kg", type=float, default=0.5)
+    parser.add_argument("--accept-cm", type=float, default=2.0)
+    parser.add_argument("--max-miss", type=float, default=0.05, help="largest share of sessions without a result")
+    parser.add_argument("--max-false", type=float, default=0.0, help="largest false-accept rate for the written point")
+    parser.add_argument("--policy", help="stability policy the replay was built with (STABILITY_POLICY)")
+    parser.add_argument("--out", default="include/tuning_tuned.h")
+    for setting, _, _, grid in PARAMS:
+        parser.add_argument("--" + setting.replace("_", "-"), nargs="+", type=type(grid[0]), default=grid,
+                            metavar="V", help=f"grid (default {' '.join(map(str, grid))})")
+    args = parser.parse_args()
+
+    if not os.access(args.program, os.X_OK):
+        sys.exit(f"{args.program} not found, build it with: pio run -e native")
+    corpus = load_corpus(args.corpus)
+    grid = list(itertools.product(*(getattr(args, s) for s, _, _, _ in PARAMS)))
+    if args.random and args.random < len(grid):
+        grid = random.sample(grid, args.random)
+    print(f"{len(grid)} candidates x {len(corpus)} traces on {args.jobs} cores", file=sys.stderr)
+
+    rows = [r for r in evaluate(args, corpus, grid) if r["missed"] <= args.max_miss]
+    if not rows:
+        sys.exit(f"every candidate missed more than {args.max_miss:.0%} of the sessions")
+    front = pareto(rows)
+
+    names = " ".join(f"{s:>12}" for s, _, _, _ in PARAMS)
+    print(f"{names}  time s  error  kg err  cm err  false %  missed %")
+    for r in front:
+        values = " ".join(f"{v:>12}" for v in r["candidate"])
+        print(f"{values}  {r['time']:6.2f}  {r['error']:5.2f}  {r['kg']:6.2f}  {r['cm']:6.2f}"
+              f"  {r['false'] * 100:7.1f}  {r['missed'] * 100:8.1f}")
+
+    # Fastest point within the false-accept limit
+    allowed = [r for r in front if r["false"] <= args.max_false]
+    if not allowed:
+        sys.exit(f"no point on the front has at most {args.max_false:.0%} false accepts, nothing written")
+    with open(args.out, "w") as f:
+        f.write(header(allowed[0], args.policy))
+    print(f"wrote {args.out}: build with -DTUNING_HEADER='\"{os.path.basename(args.out)}\"'")
+
+
+if __name__ == "__main__":
+    main()
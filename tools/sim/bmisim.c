@@ -0,0 +1,445 @@
+/*
+ * bmisim: runs the board firmware under simavr with virtual sensors, for
+ * cycle-exact measurements without hardware.
+ *
+ *   bmisim [-q] [-s seed] [-m mount_cm] firmware.elf script
+ *
+ * Build the firmware with env:profile (-DPROFILE_CYCLES), so "prof" reports
+ * each loop stage in exact CPU cycles:
+ *   pio run -e profile && make -C tools/sim run
+ *
+ * Attached to the ATmega328P:
+ *   HX711     PD_SCK on D2, DOUT on D3, RATE on D4 (10 or 80 SPS). Gain 128
+ *             and 64 on channel A follow the load, channel B reads only noise.
+ *   HC-SR04   TRIG on D10, ECHO on D9: an echo as long as the distance from
+ *             the sensor (mount height) to the head or the floor.
+ *   PCF8574   0x27 on the TWI bus, driving an HD44780 16x2 whose rows are
+ *             printed whenever a write changes them. Other addresses NACK,
+ *             so a VL53L1X build finds no sensor.
+ *   UART      monitor output to stdout, "send" lines typed in at 9600 baud.
+ *
+ * The script has one event per line, at simulated seconds:
+ *   T load KG CM   from T a person of KG and CM stands on the platform (0 0:
+ *                  nobody); stepping on and off ramps over STEP_S with some
+ *                  sway, like the recorded traces
+ *   T send TEXT    types TEXT and a newline into the console
+ *   T end          stops the simulation, 5 s after the last event if missing
+ * Lines starting with '#' are comments.
+ *
+ * Every firmware line goes to stdout; -q drops the per-pass "Height:" lines.
+ * For each session that steps on, bmisim prints the simulated time from
+ * stepping on to the firmware's "Result:" line, and a summary at the end.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sim_avr.h>
+#include <sim_elf.h>
+#include <sim_io.h>
+#include <sim_irq.h>
+#include <sim_cycle_timers.h>
+#include <sim_time.h>
+#include <avr_ioport.h>
+#include <avr_uart.h>
+#include <avr_twi.h>
+
+#define FREQUENCY 16000000
+#define SCALE_FACTOR (-21300.0) /* counts per kg, the firmware's default */
+#define SCALE_OFFSET 84000      /* empty platform */
+#define EMPTY_KG 2.0            /* below this the ranger sees the floor */
+#define STEP_S 0.6
+#define BAUD_US 1042            /* one byte at 9600 baud */
+#define MAX_EVENTS 256
+#define MAX_SESSIONS 64
+
+static avr_t *avr;
+
+static double now_s(void) { return (double)avr->cycle / FREQUENCY; }
+
+/* Deterministic noise: xorshift, roughly normal as a sum of four uniforms */
+static uint32_t rng = 2463534242u;
+
+static double noise(void) {
+	double sum = 0;
+	for (int i = 0; i < 4; ++i) {
+		rng ^= rng << 13;
+		rng ^= rng >> 17;
+		rng ^= rng << 5;
+		sum += rng / 4294967296.0 - 0.5;
+	}
+	return sum * 1.732; /* standard deviation 1 */
+}
+
+/* --- Person --- */
+static double person_kg, person_cm, from_kg, from_cm, changed_s, mount_cm = 250;
+
+static void person_set(double kg, double cm) {
+	from_kg = person_kg;
+	from_cm = person_cm;
+	person_kg = kg;
+	person_cm = cm;
+	changed_s = now_s();
+}
+
+/* Load in kg at the current time: a smooth step with a damped overshoot,
+ * then slow sway */
+static double load_kg(void) {
+	double t = now_s() - changed_s;
+	double kg = person_kg;
+	if (t < STEP_S * 3) {
+		double step = t < STEP_S ? 0.5 - 0.5 * cos(M_PI * t / STEP_S) : 1;
+		double settle = t < STEP_S ? 0 : 0.08 * exp(-(t - STEP_S) / 0.3) * sin(2 * M_PI * (t - STEP_S) / 0.4);
+		kg = from_kg + (person_kg - from_kg) * (step + settle);
+	}
+	if (person_kg > EMPTY_KG) kg += 0.04 * sin(2 * M_PI * 0.7 * now_s());
+	return kg;
+}
+
+/* Head height in cm, 0 for nobody: under the sensor once the step is done */
+static double head_cm(void) {
+	double t = now_s() - changed_s;
+	double cm = t < STEP_S && person_kg > from_kg ? from_cm : person_cm;
+	return cm > 0 ? cm + 0.5 * sin(2 * M_PI * 0.4 * now_s()) : 0;
+}
+
+/* --- HX711 ---
+ * Converts every 100 ms (RATE low) or 12.5 ms (RATE high). A conversion
+ * pulls DOUT low; the first 24 clocks shift it out, the 25th raises DOUT, and
+ * the clocks up to the next conversion select its channel and gain. */
+static avr_irq_t *dout;
+static int32_t hx_value;
+static int hx_clocks, hx_pulses = 25, hx_fast;
+
+static int32_t hx_convert(void) {
+	double counts = SCALE_OFFSET + noise() * (hx_fast ? 90 : 40);
+	if (hx_pulses == 25) counts += load_kg() * SCALE_FACTOR;
+	else if (hx_pulses == 27) counts = SCALE_OFFSET / 2 + load_kg() * SCALE_FACTOR / 2 + noise() * 45;
+	else counts = noise() * 40; /* Channel B, nothing connected */
+	if (counts > 0x7FFFFF) counts = 0x7FFFFF;
+	if (counts < -0x800000) counts = -0x800000;
+	return (int32_t)counts;
+}
+
+/* A conversion that comes due during a read is lost */
+static avr_cycle_count_t hx_conversion(avr_t *a, avr_cycle_count_t when, void *param) {
+	if (hx_clocks == 0 || hx_clocks >= 25) {
+		if (hx_clocks) hx_pulses = hx_clocks;
+		hx_clocks = 0;
+		hx_value = hx_convert();
+		avr_raise_irq(dout, 0);
+	}
+	return when + avr_usec_to_cycles(a, hx_fast ? 12500 : 100000);
+}
+
+static void hx_sck(avr_irq_t *irq, uint32_t value, void *param) {
+	if (!value || irq->value == value) return; /* Rising edges only */
+	hx_clocks++;
+	if (hx_clocks <= 24) {
+		avr_raise_irq(dout, (hx_value >> (24 - hx_clocks)) & 1);
+	} else if (hx_clocks == 25) {
+		avr_raise_irq(dout, 1);
+	}
+}
+
+static void hx_rate(avr_irq_t *irq, uint32_t value, void *param) { hx_fast = value != 0; }
+
+/* --- HC-SR04 --- */
+static avr_irq_t *echo;
+static int trig_high;
+
+static avr_cycle_count_t echo_end(avr_t *a, avr_cycle_count_t when, void *param) {
+	avr_raise_irq(echo, 0);
+	return 0;
+}
+
+static avr_cycle_count_t echo_start(avr_t *a, avr_cycle_count_t when, void *param) {
+	double cm = mount_cm - head_cm() + noise() * 0.3;
+	if (cm > 400) return 0; /* No echo, the firmware times out */
+	avr_raise_irq(echo, 1);
+	avr_cycle_timer_register_usec(a, (uint32_t)(cm * 2 * 29.15452), echo_end, NULL);
+	return 0;
+}
+
+static void us_trig(avr_irq_t *irq, uint32_t value, void *param) {
+	if (value) {
+		trig_high = 1;
+	} else if (trig_high) {
+		trig_high = 0;
+		avr_cycle_timer_register_usec(avr, 450, echo_start, NULL); /* The burst */
+	}
+}
+
+/* --- PCF8574 and HD44780 --- */
+#define LCD_ADDRESS 0x27
+static avr_irq_t *twi_in;
+static int lcd_selected, lcd_four_bit, lcd_half, lcd_en;
+static uint8_t lcd_port = 0xFF, lcd_high, lcd_address;
+static char ddram[128], shown[2][17];
+
+static void lcd_execute(int rs, uint8_t b) {
+	if (rs) {
+		ddram[lcd_address & 0x7F] = b;
+		lcd_address++;
+	} else if (b & 0x80) {
+		lcd_address = b & 0x7F;
+	} else if (b == 0x01) {
+		memset(ddram, ' ', sizeof(ddram));
+		lcd_address = 0;
+	} else if ((b & 0xFE) == 0x02) {
+		lcd_address = 0;
+	} else if ((b & 0xE0) == 0x20) {
+		lcd_four_bit = !(b & 0x10);
+		lcd_half = 0;
+	}
+}
+
+static void lcd_write(uint8_t b) {
+	int en = (b & 0x04) != 0;
+	if (lcd_en && !en) { /* Falling EN latches D4..D7 */
+		uint8_t nibble = b & 0xF0;
+		if (!lcd_four_bit) lcd_execute(b & 0x01, nibble);
+		else if (!lcd_half++) lcd_high = nibble;
+		else {
+			lcd_half = 0;
+			lcd_execute(b & 0x01, lcd_high | nibble >> 4);
+		}
+	}
+	lcd_en = en;
+	lcd_port = b;
+}
+
+static void lcd_print_changes(void) {
+	char rows[2][17];
+	memcpy(rows[0], ddram, 16);
+	memcpy(rows[1], ddram + 0x40, 16);
+	rows[0][16] = rows[1][16] = 0;
+	if (!memcmp(rows, shown, sizeof(rows))) return;
+	memcpy(shown, rows, sizeof(rows));
+	printf("sim: %8.3f s lcd |%s|%s|\n", now_s(), rows[0], rows[1]);
+}
+
+static void twi_out(avr_irq_t *irq, uint32_t value, void *param) {
+	avr_twi_msg_irq_t v;
+	v.u.v = value;
+	if (v.u.twi.msg & TWI_COND_STOP) {
+		if (lcd_selected) lcd_print_changes();
+		lcd_selected = 0;
+	}
+	if (v.u.twi.msg & TWI_COND_START) {
+		lcd_selected = (v.u.twi.addr >> 1) == LCD_ADDRESS;
+		if (lcd_selected) avr_raise_irq(twi_in, avr_twi_irq_msg(TWI_COND_ACK, v.u.twi.addr, 1));
+		return; /* Nobody else answers: NACK */
+	}
+	if (!lcd_selected) return;
+	if (v.u.twi.msg & TWI_COND_WRITE) {
+		avr_raise_irq(twi_in, avr_twi_irq_msg(TWI_COND_ACK, v.u.twi.addr, 1));
+		lcd_write(v.u.twi.data);
+	}
+	if (v.u.twi.msg & TWI_COND_READ)
+		avr_raise_irq(twi_in, avr_twi_irq_msg(TWI_COND_READ, v.u.twi.addr, lcd_port));
+}
+
+/* --- UART --- */
+static avr_irq_t *uart_in;
+static char line[256], typed[256];
+static size_t line_length, typed_length, typed_sent;
+static int quiet;
+
+struct session {
+	double on_s, result_s, kg, cm;
+	char result[96];
+};
+static struct session sessions[MAX_SESSIONS];
+static int session_count;
+
+static void firmware_line(void) {
+	line[line_length] = 0;
+	line_length = 0;
+	if (quiet && !strncmp(line, "Height: ", 8)) return;
+	printf("%s\n", line);
+	struct session *s = session_count ? &sessions[session_count - 1] : NULL;
+	if (s && !s->result[0] && !strncmp(line, "Result: ", 8)) {
+		s->result_s = now_s();
+		snprintf(s->result, sizeof(s->result), "%s", line + 8);
+		printf("sim: %8.3f s session %d: result %.3f s after stepping on\n", now_s(), session_count,
+		       s->result_s - s->on_s);
+	}
+}
+
+static void uart_out(avr_irq_t *irq, uint32_t value, void *param) {
+	if (value == '\r') return;
+	if (value == '\n' || line_length == sizeof(line) - 1) firmware_line();
+	else line[line_length++] = value;
+}
+
+static avr_cycle_count_t uart_type(avr_t *a, avr_cycle_count_t when, void *param) {
+	if (typed_sent == typed_length) return 0;
+	avr_raise_irq(uart_in, (uint8_t)typed[typed_sent++]);
+	return when + avr_usec_to_cycles(a, BAUD_US);
+}
+
+static void type_line(const char *text) {
+	typed_length = snprintf(typed, sizeof(typed), "%s\n", text);
+	typed_sent = 0;
+	avr_cycle_timer_cancel(avr, uart_type, NULL);
+	avr_cycle_timer_register_usec(avr, BAUD_US, uart_type, NULL);
+}
+
+/* --- Script --- */
+enum { LOAD, SEND, END };
+
+struct event {
+	double at_s;
+	int type;
+	double kg, cm;
+	char text[128];
+};
+static struct event events[MAX_EVENTS];
+static int event_count;
+
+static void read_script(const char *path) {
+	FILE *in = fopen(path, "r");
+	if (!in) {
+		perror(path);
+		exit(1);
+	}
+	char text[256];
+	for (int number = 1; fgets(text, sizeof(text), in); ++number) {
+		char verb[16];
+		int used = 0;
+		struct event *e = &events[event_count];
+		text[strcspn(text, "\r\n")] = 0;
+		if (text[0] == '#' || sscanf(text, "%lf %15s %n", &e->at_s, verb, &used) < 2) continue;
+		if (event_count == MAX_EVENTS) {
+			fprintf(stderr, "%s: more than %d events\n", path, MAX_EVENTS);
+			exit(1);
+		}
+		if (event_count && e->at_s < events[event_count - 1].at_s) {
+			fprintf(stderr, "%s:%d: events must be in time order\n", path, number);
+			exit(1);
+		}
+		if (!strcmp(verb, "load") && sscanf(text + used, "%lf %lf", &e->kg, &e->cm) == 2) e->type = LOAD;
+		else if (!strcmp(verb, "send")) {
+			e->type = SEND;
+			snprintf(e->text, sizeof(e->text), "%s", text + used);
+		} else if (!strcmp(verb, "end")) e->type = END;
+		else {
+			fprintf(stderr, "%s:%d: expected load KG CM, send TEXT or end\n", path, number);
+			exit(1);
+		}
+		event_count++;
+	}
+	fclose(in);
+	if (!event_count || events[event_count - 1].type != END) {
+		struct event *e = &events[event_count < MAX_EVENTS ? event_count++ : MAX_EVENTS - 1];
+		e->at_s = event_count > 1 ? events[event_count - 2].at_s + 5 : 5;
+		e->type = END;
+	}
+}
+
+/* Applies the event; false once the script ends */
+static int apply(const struct event *e) {
+	switch (e->type) {
+	case LOAD:
+		if (e->kg > EMPTY_KG && person_kg <= EMPTY_KG && session_count < MAX_SESSIONS) {
+			struct session *s = &sessions[session_count++];
+			s->on_s = e->at_s;
+			s->kg = e->kg;
+			s->cm = e->cm;
+		}
+		person_set(e->kg, e->cm);
+		printf("sim: %8.3f s load %.2f kg, %.1f cm\n", now_s(), e->kg, e->cm);
+		return 1;
+	case SEND:
+		type_line(e->text);
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+static void summary(void) {
+	printf("sim: session  on at s  expected kg / cm  result s  firmware result\n");
+	for (int i = 0; i < session_count; ++i) {
+		struct session *s = &sessions[i];
+		if (s->result[0])
+			printf("sim: %7d  %8.3f  %7.2f / %5.1f  %8.3f  %s\n", i + 1, s->on_s, s->kg, s->cm,
+			       s->result_s - s->on_s, s->result);
+		else
+			printf("sim: %7d  %8.3f  %7.2f / %5.1f  %8s  -\n", i + 1, s->on_s, s->kg, s->cm, "none");
+	}
+}
+
+static void usage(const char *program) {
+	fprintf(stderr, "usage: %s [-q] [-s seed] [-m mount_cm] firmware.elf script\n", program);
+	exit(2);
+}
+
+int main(int argc, char **argv) {
+	int opt;
+	while ((opt = getopt(argc, argv, "qs:m:")) != -1) {
+		switch (opt) {
+		case 'q': quiet = 1; break;
+		case 's': rng = strtoul(optarg, NULL, 0) | 1; break;
+		case 'm': mount_cm = atof(optarg); break;
+		default: usage(argv[0]);
+		}
+	}
+	if (argc - optind != 2) usage(argv[0]);
+	read_script(argv[optind + 1]);
+
+	elf_firmware_t firmware;
+	memset(&firmware, 0, sizeof(firmware));
+	if (elf_read_firmware(argv[optind], &firmware)) {
+		fprintf(stderr, "%s: not an AVR ELF\n", argv[optind]);
+		return 1;
+	}
+	strcpy(firmware.mmcu, "atmega328p");
+	firmware.frequency = FREQUENCY;
+	avr = avr_make_mcu_by_name(firmware.mmcu);
+	if (!avr) {
+		fprintf(stderr, "simavr has no %s core\n", firmware.mmcu);
+		return 1;
+	}
+	avr_init(avr);
+	avr_load_firmware(avr, &firmware);
+
+	dout = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('D'), 3);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('D'), 2), hx_sck, NULL);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('D'), 4), hx_rate, NULL);
+	avr_raise_irq(dout, 1);
+	avr_cycle_timer_register_usec(avr, 100000, hx_conversion, NULL);
+
+	echo = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), 1);
+	avr_raise_irq(echo, 0);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), 2), us_trig, NULL);
+
+	memset(ddram, ' ', sizeof(ddram));
+	twi_in = avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_INPUT);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_OUTPUT), twi_out, NULL);
+
+	uint32_t flags = 0;
+	avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+	flags &= ~AVR_UART_FLAG_STDIO; /* Lines go through uart_out only */
+	avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+	uart_in = avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_INPUT);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUTPUT), uart_out, NULL);
+
+	int next = 0, state = cpu_Running;
+	while (state != cpu_Done && state != cpu_Crashed) {
+		while (next < event_count && now_s() >= events[next].at_s) {
+			if (!apply(&events[next++])) {
+				next = -1;
+				break;
+			}
+		}
+		if (next < 0) break;
+		state = avr_run(avr);
+	}
+	if (line_length) firmware_line();
+	if (state == cpu_Crashed) printf("sim: %8.3f s firmware crashed\n", now_s());
+	summary();
+	return state == cpu_Crashed;
+}
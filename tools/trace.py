@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+"""Capture, send and decode sensor traces (frame format in include/trace.h).
+
+  trace.py capture PORT FILE   record a trace from the scale until Ctrl-C
+  trace.py send PORT FILE      feed a trace to a -DTRACE_REPLAY board
+  trace.py dump FILE           print the records as text
+
+capture and send need pyserial. To replay on the workstation instead, run
+the env:native program (platformio.ini) on FILE.
+"""
+import argparse
+import sys
+import time
+
+SYNC, ACK, WINDOW = 0xA5, 0x06, 63
+SCALE, RANGE, STATE, TEXT = 1, 2, 3, 4
+SERIAL_BAUD, EXPORT_BAUD = 9600, 500000
+
+
+def frames(data):
+    """Yields (payload, raw frame bytes, end offset); other bytes are skipped."""
+    i = 0
+    while i + 2 <= len(data):
+        if data[i] != SYNC or data[i + 1] == 0:
+            i += 1
+            continue
+        end = i + 2 + data[i + 1]
+        if end > len(data):
+            break
+        yield data[i + 2:end], data[i:end], end
+        i = end
+
+
+def varints(payload, start):
+    values, v, shift = [], 0, 0
+    for b in payload[start:]:
+        v |= (b & 0x7F) << shift
+        shift += 7
+        if not b & 0x80:
+            values.append(v)
+            v, shift = 0, 0
+    return values
+
+
+def unzigzag(v):
+    return (v >> 1) ^ -(v & 1)
+
+
+def text_of(payload):
+    """Characters of a TEXT payload, after the type and dt varint."""
+    n = 1
+    while payload[n] & 0x80:
+        n += 1
+    return payload[n + 1:].decode("ascii", "replace")
+
+
+def open_port(port, baud):
+    try:
+        import serial
+    except ImportError:
+        sys.exit("pyserial is needed: pip install pyserial")
+    return serial.Serial(port, baud, timeout=0.05)
+
+
+def capture(args):
+    with open_port(args.port, SERIAL_BAUD) as s, open(args.file, "wb") as out:
+        s.write(b"trace\n")
+        deadline = time.time() + 3
+        while b"Trace at" not in s.readline():
+            if time.time() > deadline:
+                sys.exit("no reply to 'trace'; is the firmware running?")
+        s.baudrate = EXPORT_BAUD
+        pending = b""
+        try:
+            while True:
+                data = s.read(4096)
+                out.write(data)
+                pending += data
+                # Show the monitor text carried in TEXT frames
+                used = 0
+                for payload, _, used in frames(pending):
+                    if payload[0] == TEXT:
+                        sys.stdout.write(text_of(payload))
+                pending = pending[used:]
+                sys.stdout.flush()
+        except KeyboardInterrupt:
+            s.write(b"trace\n")
+    print("\nsaved", args.file)
+
+
+def send(args):
+    data = open(args.file, "rb").read()
+    queue = [raw for _, raw, _ in frames(data)]
+    inflight = []  # sizes of the frames not acknowledged yet
+    last_ack = time.time()
+    with open_port(args.port, EXPORT_BAUD) as s:
+        while queue or inflight:
+            while queue and sum(inflight) + len(queue[0]) <= WINDOW:
+                s.write(queue[0])
+                inflight.append(len(queue.pop(0)))
+            data = s.read(256)
+            text = bytearray()
+            for b in data:
+                if b == ACK and inflight:
+                    inflight.pop(0)
+                    last_ack = time.time()
+                elif b != ACK:
+                    text.append(b)
+            sys.stdout.write(text.decode("ascii", "replace"))
+            sys.stdout.flush()
+            if inflight and time.time() - last_ack > 2:
+                print("\n[no ack for 2 s, taking the window as lost]", file=sys.stderr)
+                inflight.clear()
+                last_ack = time.time()
+        # Let the last session finish printing
+        end = time.time() + args.tail
+        while time.time() < end:
+            sys.stdout.write(s.read(256).replace(bytes([ACK]), b"").decode("ascii", "replace"))
+            sys.stdout.flush()
+
+
+def dump(args):
+    t, raw, reading = 0, None, 0
+    for payload, _, _ in frames(open(args.file, "rb").read()):
+        kind = payload[0]
+        if kind == TEXT:
+            print(f"{t:>12} text  {text_of(payload).rstrip()}")
+            continue
+        values = varints(payload, 1)
+        if not values:
+            continue
+        t += values[0]
+        if kind == SCALE:
+            # Counts start from zero at the beginning of a capture
+            deltas = [unzigzag(v) for v in values[1:]]
+            raw = [a + b for a, b in zip(raw or [0] * len(deltas), deltas)]
+            print(f"{t:>12} scale {' '.join(map(str, raw))}")
+        elif kind == RANGE:
+            reading += unzigzag(values[1])
+            print(f"{t:>12} range {reading}")
+        elif kind == STATE:
+            print(f"{t:>12} state offset {unzigzag(values[1])}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="command", required=True)
+    p = sub.add_parser("capture")
+    p.add_argument("port")
+    p.add_argument("file")
+    p.set_defaults(run=capture)
+    p = sub.add_parser("send")
+    p.add_argument("port")
+    p.add_argument("file")
+    p.add_argument("--tail", type=float, default=3, help="seconds to keep printing after the last frame")
+    p.set_defaults(run=send)
+    p = sub.add_parser("dump")
+    p.add_argument("file")
+    p.set_defaults(run=dump)
+    args = parser.parse_args()
+    args.run(args)
+
+
+if __name__ == "__main__":
+    main()